@@ -4,6 +4,10 @@
 #include <iostream>
 
 #include "Client.hpp"
+#include "metrics/MemoryUsage.hpp"
+#include "metrics/Probes.hpp"
+#include "metrics/ProfScope.hpp"
+#include "metrics/Trace.hpp"
 #include "utils.hpp"
 #ifdef _WIN32
 #include <winsock2.h>
@@ -23,7 +27,10 @@ Channel::Channel()
       _invited(),
       _topicRestricted(false),
       _key(""),
-      _clientLimit(-1) {}
+      _clientLimit(-1),
+      _bans(),
+      _exceptions(),
+      _inviteExceptions() {}
 
 Channel::Channel(const std::string& name)
     : _name(name),
@@ -36,7 +43,10 @@ Channel::Channel(const std::string& name)
       _invited(),
       _topicRestricted(false),
       _key(""),
-      _clientLimit(-1) {}
+      _clientLimit(-1),
+      _bans(),
+      _exceptions(),
+      _inviteExceptions() {}
 
 Channel::~Channel() {}
 
@@ -51,7 +61,10 @@ Channel::Channel(const Channel& other)
       _invited(other._invited),
       _topicRestricted(other._topicRestricted),
       _key(other._key),
-      _clientLimit(other._clientLimit) {}
+      _clientLimit(other._clientLimit),
+      _bans(other._bans),
+      _exceptions(other._exceptions),
+      _inviteExceptions(other._inviteExceptions) {}
 
 Channel& Channel::operator=(const Channel& other) {
     if (this != &other) {
@@ -66,6 +79,9 @@ Channel& Channel::operator=(const Channel& other) {
         _topicRestricted = other._topicRestricted;
         _key = other._key;
         _clientLimit = other._clientLimit;
+        _bans = other._bans;
+        _exceptions = other._exceptions;
+        _inviteExceptions = other._inviteExceptions;
     }
     return *this;
 }
@@ -172,44 +188,38 @@ void Channel::logClients() const {
 }
 
 void Channel::broadcast(const std::string& message, Client* except) {
-    std::cout << "[INFO] channel='" << _name
-              << "' except_fd=" << (except ? except->getFd() : -1)
-              << " message=\"" << message << "\"\n";
+    PROF_SCOPE("Channel::broadcast");
+    IRC_PROBE3(channel__broadcast, _name.c_str(), _clients.size(), message.size());
 
     for (Client* member : _clients) {
-        std::cout << "[INFO] member ptr=" << member;
-
-        if (!member) {
-            std::cout << " (null) — skipping\n";
+        if (!member || member == except)
             continue;
-        }
 
         int fd = member->getFd();
-        std::cout << ", nick='" << member->getNick() << "', fd=" << fd << "\n";
-
-        if (member == except) {
-            std::cout << "[INFO] skipping sender '" << member->getNick()
-                      << "'\n";
-            continue;
-        }
-
         if (fd <= 0) {
-            std::cout << "[WARNING broadcast] invalid fd for '"
+            std::cerr << "[WARNING broadcast] invalid fd for '"
                       << member->getNick() << "': " << fd << "\n";
             continue;
         }
 
-        ssize_t sent = ::send(fd, message.c_str(), message.size(), 0);
-        if (sent < 0)
-            perror("[ERROR broadcast] send failed");
-        else
-            std::cout << "[INFO] sent " << sent << " bytes to '"
-                      << member->getNick() << "' (fd=" << fd << ")\n";
+        TraceSpan sendSpan("send", g_tracer.currentFd(), fd);
+        sendMessage(fd, message);
     }
 }
 
 std::vector<Client*> Channel::getClients() const { return _clients; }
 
+std::string Channel::namesReply(const std::string& nick) const {
+    std::string reply = ":ft_irc 353 " + nick + " = " + _name + " :";
+    for (Client* member : _clients) {
+        if (isOperator(member))
+            reply += "@";
+        reply += member->getNick() + " ";
+    }
+    reply += "\r\n";
+    return reply;
+}
+
 void Channel::setTopicRestricted(bool restricted) {
     _topicRestricted = restricted;
 }
@@ -221,5 +231,46 @@ void Channel::removeOp(int clientFd) {
     _ops.erase(std::remove(_ops.begin(), _ops.end(), clientFd), _ops.end());
 }
 
+size_t Channel::memberListBytes() const {
+    return _clients.capacity() * sizeof(Client*) + _ops.capacity() * sizeof(int);
+}
+
+size_t Channel::inviteListBytes() const {
+    size_t bytes = 0;
+    for (const auto& entry : _invited)
+        bytes += kTreeNodeOverhead + sizeof(entry) + stringHeapBytes(entry.first);
+    return bytes;
+}
+
+size_t Channel::maskListBytes() const {
+    return _bans.heapBytes() + _exceptions.heapBytes() +
+           _inviteExceptions.heapBytes();
+}
+
+MaskList& Channel::maskList(char mode) {
+    if (mode == 'e')
+        return _exceptions;
+    if (mode == 'I')
+        return _inviteExceptions;
+    return _bans;
+}
+
+// Masks are matched against the prefix other members see, nick!~user@ip.
+static bool matchesClient(const MaskList& list, Client* client) {
+    if (list.empty())
+        return false;
+    return list.matches(ircCaseFold(client->getNick()),
+                        ircCaseFold("~" + client->getUser()),
+                        ircCaseFold(client->getIPa()));
+}
+
+bool Channel::isBanned(Client* client) const {
+    return matchesClient(_bans, client) && !matchesClient(_exceptions, client);
+}
+
+bool Channel::isInviteExempt(Client* client) const {
+    return matchesClient(_inviteExceptions, client);
+}
+
 const std::string& Channel::getNormalizedName() const { return normalizedName; }
 const std::string& Channel::getModeKey() const { return _key; }
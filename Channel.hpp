@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Client.hpp"
+#include "modes/MaskList.hpp"
 
 class Channel {
 public:
@@ -64,6 +65,9 @@ public:
     // Get list of clients in the channel
     std::vector<Client*> getClients() const;
 
+    // RPL_NAMREPLY (353) line for 'nick', operators prefixed with '@'.
+    std::string namesReply(const std::string& nick) const;
+
     // MODE
     std::vector<int>& getOps() { return _ops; }
 
@@ -85,6 +89,20 @@ public:
 
     void logClients() const;
 
+    // List modes: 'b' (bans), 'e' (ban exceptions) and 'I' (invite
+    // exceptions).
+    MaskList& maskList(char mode);
+    // Matched by a ban and not by an exception.
+    bool isBanned(Client* client) const;
+    // Matched by an invite exception: may join while +i without an INVITE.
+    bool isInviteExempt(Client* client) const;
+
+    // Heap bytes of the member and operator vectors, and of the invite map
+    // (see metrics/MemoryUsage.hpp).
+    size_t memberListBytes() const;
+    size_t inviteListBytes() const;
+    size_t maskListBytes() const;
+
 private:
     std::string _name;
     std::string normalizedName;
@@ -103,6 +121,9 @@ private:
     bool _topicRestricted = false;
     std::string _key = "";
     int _clientLimit = -1;  // –1 means unlimited
+    MaskList _bans;
+    MaskList _exceptions;
+    MaskList _inviteExceptions;
 };
 
 #endif  // CHANNEL_HPP
@@ -4,6 +4,8 @@
 
 #include <iostream>
 
+#include "metrics/MemoryUsage.hpp"
+
 Client::Client()
     : _nickname(""),
       _password(""),
@@ -12,10 +14,18 @@ Client::Client()
       _fd(-1),
       _isRegistered(false),
       _key(""),
-      _isInvisible(false) {}
+      _isInvisible(false),
+      _pingPending(false),
+      _lastActivityNs(0) {}
 
 Client::Client(int fd, const std::string& ip)
-    : _ipA(ip), _fd(fd), _isRegistered(false), _key(""), _isInvisible(false) {}
+    : _ipA(ip),
+      _fd(fd),
+      _isRegistered(false),
+      _key(""),
+      _isInvisible(false),
+      _pingPending(false),
+      _lastActivityNs(0) {}
 
 Client::Client(int fd, const sockaddr_in& addr)
     : _nickname(""),
@@ -24,7 +34,9 @@ Client::Client(int fd, const sockaddr_in& addr)
       _fd(fd),
       _isRegistered(false),
       _key(""),
-      _isInvisible(false) {
+      _isInvisible(false),
+      _pingPending(false),
+      _lastActivityNs(0) {
     char ip[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &(addr.sin_addr), ip, INET_ADDRSTRLEN);
     _ipA = ip;
@@ -40,7 +52,9 @@ Client::Client(const Client& other)
       _fd(other.getFd()),
       _isRegistered(other.isRegistered()),
       _key(other.getModeKey()),
-      _isInvisible(other.isInvisible()) {}
+      _isInvisible(other.isInvisible()),
+      _pingPending(other.isPingPending()),
+      _lastActivityNs(other.getLastActivity()) {}
 
 Client& Client::operator=(const Client& other) {
     if (this != &other) {
@@ -52,6 +66,8 @@ Client& Client::operator=(const Client& other) {
         _isRegistered = other.isRegistered();
         _key = other.getModeKey();
         _isInvisible = other.isInvisible();
+        _pingPending = other.isPingPending();
+        _lastActivityNs = other.getLastActivity();
     }
     return *this;
 }
@@ -68,6 +84,12 @@ const std::string& Client::getUser() const { return _username; }
 
 const std::string& Client::getIPa() const { return _ipA; }
 
+size_t Client::stringBytes() const {
+    return stringHeapBytes(_nickname) + stringHeapBytes(_password) +
+           stringHeapBytes(_username) + stringHeapBytes(_ipA) +
+           stringHeapBytes(_key);
+}
+
 void Client::setAsRegistered() {
     _isRegistered = true;
     std::cout << "[INFO] Client fd=" << _fd << " marked as registered"
@@ -112,3 +134,14 @@ void Client::setFd(int fd) { _fd = fd; }
 void Client::setInvisible(bool value) { _isInvisible = value; }
 
 bool Client::isInvisible() const { return _isInvisible; }
+
+void Client::touch(uint64_t nowNs) {
+    _lastActivityNs = nowNs;
+    _pingPending = false;
+}
+
+uint64_t Client::getLastActivity() const { return _lastActivityNs; }
+
+bool Client::isPingPending() const { return _pingPending; }
+
+void Client::setPingPending(bool pending) { _pingPending = pending; }
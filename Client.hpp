@@ -2,6 +2,7 @@
 
 #include <netinet/in.h>
 
+#include <cstdint>
 #include <string>
 
 class Client {
@@ -20,6 +21,8 @@ public:
     const std::string& getNick() const;
     const std::string& getUser() const;
     const std::string& getIPa() const;
+    // Heap bytes held by this client's strings (see metrics/MemoryUsage.hpp).
+    size_t stringBytes() const;
 
     // Setters
     void setAsRegistered();
@@ -37,6 +40,14 @@ public:
     void setInvisible(bool value);
     bool isInvisible() const;
 
+    // Keepalive: io() time of the last bytes received, and whether a
+    // server PING is still unanswered. touch() records activity and
+    // settles the PING.
+    void touch(uint64_t nowNs);
+    uint64_t getLastActivity() const;
+    bool isPingPending() const;
+    void setPingPending(bool pending);
+
 private:
     std::string _nickname;
     std::string _password;
@@ -46,4 +57,6 @@ private:
     bool _isRegistered;
     std::string _key;
     bool _isInvisible;
+    bool _pingPending;
+    uint64_t _lastActivityNs;
 };
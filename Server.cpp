@@ -1,16 +1,18 @@
 #include "Server.hpp"
 
 #include <arpa/inet.h>  // <-- Needed for inet_ntoa
-#include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
-#include <deque>
+#include <list>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_set>
 
 #include "Channel.hpp"
 #include "commands/join.hpp"
@@ -20,60 +22,71 @@
 #include "commands/privmsg.hpp"
 #include "commands/quit.hpp"
 #include "commands/ping.hpp"
+#include "metrics/AllocTrack.hpp"
+#include "metrics/Clock.hpp"
+#include "metrics/Probes.hpp"
+#include "metrics/ProfScope.hpp"
+#include "metrics/Trace.hpp"
+#include "net/IoLayer.hpp"
+#include "net/SendQueue.hpp"
+#include "utf8.hpp"
 #include "utils.hpp"
 
-Server::Server(int port, std::string password, bool debugMode)
-    : _port(port), _password(password), _nextClientId(0), _debugMode(debugMode)
-{
-    _server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (_server_fd < 0)
-    {
-        perror("socket");
-        throw std::runtime_error("Failed to create socket");
-    }
-
-    if (fcntl(_server_fd, F_SETFL, O_NONBLOCK) < 0)
-    {
-        perror("fcntl");
-        throw std::runtime_error("Failed to set socket to non-blocking");
-    }
-
-    int opt = 1;
-    if (setsockopt(_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
-    {
-        perror("setsockopt");
-        throw std::runtime_error("Failed to set socket options");
-    }
+static const uint64_t kNsPerSecond = 1000000000ull;
+static const uint64_t kTimerTickNs = 100000000ull;  // keepalive resolution
 
-    sockaddr_in addr = {};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(_port);
-    addr.sin_addr.s_addr = INADDR_ANY;
+volatile sig_atomic_t Server::_shutdownRequested = 0;
 
-    if (bind(_server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
-    {
-        perror("bind");
-        throw std::runtime_error("Failed to bind");
-    }
+void Server::requestShutdown() { _shutdownRequested = 1; }
 
-    if (listen(_server_fd, SOMAXCONN) < 0)
-    {
-        perror("listen");
-        throw std::runtime_error("Failed to listen");
-    }
+Server::Server(int port, std::string password, bool debugMode, const ServerConfig& config)
+    : _port(port),
+      _password(password),
+      _timers(kTimerTickNs, io().nowNs()),
+      _nextClientId(0),
+      _debugMode(debugMode),
+      _config(config),
+      _admin_fd(-1)
+{
+    _server_fd = io().listen(_port);
 
     pollfd pfd = {};
     pfd.fd = _server_fd;
     pfd.events = POLLIN;
     _poll_fds.push_back(pfd);
+
+    openAdminEndpoint();
+    loadBans();
+
+    if (!_config.traceFile.empty())
+        g_tracer.open(_config.traceFile, _config.traceSample, _config.traceMaxEvents);
+    if (!_config.captureFile.empty())
+        _capture.open(_config.captureFile);
 }
 
-Server::Server(const Server& other) : _port(other.getPort()), _password(other.getPassword()) {}
+Server::Server(const Server& other)
+    : _port(other.getPort()),
+      _password(other.getPassword()),
+      _timers(kTimerTickNs, 0),
+      _admin_fd(-1)
+{
+}
 
 Server::~Server()
 {
-    close(_server_fd);
-    for (size_t i = 1; i < _poll_fds.size(); ++i) close(_poll_fds[i].fd);
+    g_tracer.close();
+    io().close(_server_fd);
+    for (size_t i = 1; i < _poll_fds.size(); ++i)
+    {
+        int fd = _poll_fds[i].fd;
+        if (fd == _admin_fd || _adminConns.count(fd))
+        {
+            close(fd);
+            continue;
+        }
+        g_sendQueues.close(fd);
+        io().close(fd);
+    }
 }
 
 Server& Server::operator=(const Server& other)
@@ -89,151 +102,527 @@ Server& Server::operator=(const Server& other)
 void Server::run()
 {
     std::cout << "Server running on port " << _port << std::endl;
-    while (true)
+    while (!_shutdownRequested && tick(-1) >= 0)
     {
-        int ret = poll(_poll_fds.data(), _poll_fds.size(), -1);
-        if (ret < 0)
-        {
-            perror("poll");
-            break;
-        }
+    }
+}
 
-        for (size_t i = 0; i < _poll_fds.size(); ++i)
+int Server::tick(int timeoutMs)
+{
+    timeoutMs = pollTimeout(timeoutMs);
+
+    _metrics.ticks.beginPoll(monotonicNs());
+    int ret = io().poll(_poll_fds.data(), _poll_fds.size(), timeoutMs);
+    _metrics.ticks.endPoll(monotonicNs(), ret);
+    PROF_POLL_REPORT();
+    ALLOC_POLL_REPORT();
+    if (ret < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+        perror("poll");
+        return -1;
+    }
+
+    for (size_t i = 0; i < _poll_fds.size(); ++i)
+    {
+        short revents = _poll_fds[i].revents;
+        if (!revents)
+            continue;
+
+        int fd = _poll_fds[i].fd;
+        if (_adminConns.count(fd))
         {
-            if (_poll_fds[i].revents & POLLIN)
-            {
-                if (_poll_fds[i].fd == _server_fd)
-                    acceptClient();
-                else
-                    receiveData(_poll_fds[i].fd, i);
-            }
+            handleAdminIO(fd, i, revents);
+            continue;
         }
+        if (revents & POLLOUT)
+            flushSendQueue(i);
+        // A paused client is not polled for POLLIN, but a hangup still has
+        // to reach recv() or the fd would be reported forever.
+        if (!(revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        else if (fd == _server_fd)
+            acceptClient();
+        else if (fd == _admin_fd)
+            acceptAdmin();
+        else
+            receiveData(fd, i);
     }
+
+    ret += processWaitingLines();
+    if (!_closeQueue.empty())
+    {
+        std::vector<int> closing;
+        closing.swap(_closeQueue);
+        dropConnections(closing);
+    }
+    expireTimers();
+    dropSlowConsumers();
+    watchBlockedQueues();
+    resumeReaders();
+
+    const TickProfiler::Tick& tick = _metrics.ticks.endTick(monotonicNs());
+    if (_config.slowTickMs > 0 &&
+        tick.processNs > static_cast<uint64_t>(_config.slowTickMs) * 1000000)
+    {
+        _metrics.ticks.countSlowTick();
+        std::cerr << "[WARN] Slow tick: " << describeTick(tick) << std::endl;
+    }
+    return ret;
 }
 
 void Server::acceptClient()
 {
+    // Take the whole backlog: one accept per tick leaves a connection burst
+    // waiting behind a full poll() pass per client.
     sockaddr_in client_addr;
-    socklen_t len = sizeof(client_addr);
-    int client_fd = accept(_server_fd, (sockaddr*)&client_addr, &len);
-
-    if (client_fd < 0)
+    int client_fd;
+    while ((client_fd = io().accept(_server_fd, client_addr)) >= 0)
     {
-        perror("accept");
-        return;
-    }
-
-    fcntl(client_fd, F_SETFL, O_NONBLOCK);
+        _metrics.connectionsAccepted++;
 
-    _clients.emplace_back(client_fd, client_addr);
-
-    pollfd pfd = {};
-    pfd.fd = client_fd;
-    pfd.events = POLLIN;
-    _poll_fds.push_back(pfd);
+        // Refused before anything is allocated for it: a connection flood
+        // costs an accept and a close per socket, nothing more.
+        if (isDlined(client_addr))
+        {
+            static const char banned[] = "ERROR :Closing Link: (D-lined)\r\n";
+            io().send(client_fd, banned, sizeof(banned) - 1);
+            io().close(client_fd);
+            _metrics.dlineRefused++;
+            continue;
+        }
+        if (_config.maxUnregistered > 0 && _unregistered >= _config.maxUnregistered)
+        {
+            static const char refusal[] =
+                "ERROR :Too many unregistered connections, try again later\r\n";
+            io().send(client_fd, refusal, sizeof(refusal) - 1);
+            io().close(client_fd);
+            _metrics.registrationFailures[REG_CAPACITY]++;
+            continue;
+        }
+        const ConnectionClass& cls = _config.classFor(client_addr);
+        if (!admitAddress(client_fd, client_addr, cls))
+            continue;
 
-    std::cout << "[INFO] New Client created: fd=" << client_fd
-              << ", ip=" << inet_ntoa(client_addr.sin_addr) << std::endl;
-    std::cout << "Accepted client fd: " << client_fd << std::endl;
+        _clients.emplace_back(client_fd, client_addr);
+        indexClient(std::prev(_clients.end()));
+        g_sendQueues.open(client_fd, cls);
+        _flood.open(client_fd, cls, io().nowNs());
+        _clients.back().touch(io().nowNs());
+        ++_unregistered;
+        if (_config.registrationTimeout > 0)
+            _timers.schedule(client_fd,
+                             io().nowNs() + _config.registrationTimeout * kNsPerSecond);
+        else
+            armKeepalive(client_fd);
+        _capture.connect(client_fd, client_addr);
+        IRC_PROBE2(client__accept, client_fd, _clients.back().getIPa().c_str());
+
+        pollfd pfd = {};
+        pfd.fd = client_fd;
+        pfd.events = POLLIN;
+        _poll_fds.push_back(pfd);
+
+        std::cout << "[INFO] New Client created: fd=" << client_fd
+                  << ", ip=" << inet_ntoa(client_addr.sin_addr) << std::endl;
+        std::cout << "Accepted client fd: " << client_fd << std::endl;
+
+        // Send welcome message to the connecting client
+        std::string welcome = "Welcome to the IRC server. please provide PASS, USER, NICK:\r\n";
+        sendMessage(client_fd, welcome);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+        perror("accept");
+}
 
-    // Send welcome message to the connecting client
-    std::string welcome = "Welcome to the IRC server. please provide PASS, USER, NICK:\r\n";
-    send(client_fd, welcome.c_str(), welcome.length(), 0);
+// Applies cls's per-address limits to a connection just accepted from
+// addr. A refused connection is told why and closed at once.
+bool Server::admitAddress(int fd, const sockaddr_in& addr, const ConnectionClass& cls)
+{
+    const int prefix = _config.ipLimitPrefix;
+    const uint32_t key = ntohl(addr.sin_addr.s_addr) & (0xffffffffu << (32 - prefix));
+    IpVerdict verdict = _ipLimits.admit(fd, key, cls, io().nowNs());
+    if (verdict == IP_ADMITTED)
+        return true;
+
+    static const char tooMany[] = "ERROR :Too many connections from your host\r\n";
+    static const char throttled[] = "ERROR :Reconnecting too fast, try again later\r\n";
+    if (verdict == IP_TOO_MANY)
+    {
+        io().send(fd, tooMany, sizeof(tooMany) - 1);
+        _metrics.ipLimitRefused++;
+    }
+    else
+    {
+        io().send(fd, throttled, sizeof(throttled) - 1);
+        _metrics.connectThrottled++;
+    }
+    io().close(fd);
+    return false;
 }
 
 void Server::receiveData(int clientFd, size_t index)
 {
+    PROF_SCOPE("receiveData");
+    ALLOC_SCOPE(ALLOC_EVENT_LOOP, clientFd);
+
+    // Lines waiting for the next tick run before more are read; reading on
+    // would only grow the buffer. Throttled clients are still read, so
+    // recvq can catch a flood.
+    std::unordered_map<int, uint64_t>::const_iterator waiting = _linesWaiting.find(clientFd);
+    if (waiting != _linesWaiting.end() && waiting->second == 0)
+        return;
+    const bool throttled = waiting != _linesWaiting.end();
+
+    TraceSample sample(clientFd);
     char buffer[1024];
-    ssize_t n = recv(clientFd, buffer, sizeof(buffer), 0);
+    ssize_t n;
+    {
+        TraceSpan recvSpan("recv", clientFd);
+        n = io().recv(clientFd, buffer, sizeof(buffer));
+    }
     if (n <= 0)
     {
         std::cout << "[INFO] Client disconnected: fd=" << clientFd << std::endl;
-        close(clientFd);
-        _recvBuffers.erase(clientFd);
-        _poll_fds.erase(_poll_fds.begin() + index);
+        IRC_PROBE1(client__disconnect, clientFd);
+        _metrics.connectionsClosed++;
+        if (!isRegistered(clientFd) && getClientObjByFd(clientFd))
+            _metrics.registrationFailures[REG_ABANDONED]++;
+        releaseConnection(clientFd, index);
+        removeClientFromChannels(clientFd);
         eraseClient(clientFd, &index);
         return;
     }
 
+    _metrics.bytesReceived += n;
+    if (Client* client = getClientObjByFd(clientFd))
+        client->touch(io().nowNs());
+
+    _recvBuffers[clientFd].append(buffer, n);
+    if (!throttled)
+        processLines(clientFd);
+
+    const ConnectionClass* cls = _flood.connectionClass(clientFd);
+    if (cls && _recvBuffers[clientFd].size() > cls->recvQ)
+    {
+        _metrics.excessFlood[cls->name]++;
+        std::cerr << "[WARN] Excess Flood: fd=" << clientFd << ", class " << cls->name << ", "
+                  << _recvBuffers[clientFd].size() << " bytes unprocessed" << std::endl;
+        closeLink(clientFd, index, "Excess Flood");
+    }
+}
+
+// Dispatches the complete lines buffered for clientFd. Stops early once the
+// client's output is congested, it has used this tick's line budget, or it
+// is registered and out of tokens for the next command; the rest stays
+// buffered until it may run.
+void Server::processLines(int clientFd)
+{
     auto& pending = _recvBuffers[clientFd];
-    pending.append(buffer, n);
+    const uint64_t queuedBefore = g_sendQueues.queuedBytes();
+    const uint64_t submittedBefore = g_sendQueues.submittedBytes();
+    unsigned ran = 0;
     size_t pos;
-    while ((pos = pending.find('\n')) != std::string::npos)
+    while (!_readPaused.count(clientFd) && (pos = pending.find('\n')) != std::string::npos)
     {
-        std::string line = pending.substr(0, pos);
-        if (!line.empty() && line.back() == '\r')
-            line.pop_back();
-        pending.erase(0, pos + 1);
+        if (_config.tickLineBudget && ran == _config.tickLineBudget)
+        {
+            _metrics.budgetDeferred++;
+            _linesWaiting[clientFd] = 0;
+            break;
+        }
+        if (isRegistered(clientFd))
+        {
+            uint64_t readyNs =
+                _flood.take(clientFd, floodClassFor(pending.data(), pos), io().nowNs());
+            if (readyNs)
+            {
+                _metrics.floodDeferred++;
+                _linesWaiting[clientFd] = readyNs;
+                break;
+            }
+        }
+        ++ran;
+        _metrics.linesReceived++;
+        std::string line;
+        {
+            TraceSpan frameSpan("frame", clientFd);
+            line = pending.substr(0, pos);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            pending.erase(0, pos + 1);
+        }
+        _capture.line(clientFd, line);
         if (!isRegistered(clientFd))
         {
-            registerClient(clientFd, line, &index);
+            ALLOC_SCOPE(ALLOC_REGISTER, clientFd);
+            g_tracer.setCommand("REGISTER");
+            TraceSpan handlerSpan("handler", clientFd);
+            uint64_t startNs = monotonicNs();
+            registerClient(clientFd, line, nullptr);
+            _metrics.ticks.recordHandler("REGISTER", clientFd, monotonicNs() - startNs);
         }
         else
         {
             dispatchCommand(line, clientFd);
         }
+        pauseIfCongested(clientFd, queuedBefore, submittedBefore);
     }
 }
 
-void Server::eraseClient(int clientFd, size_t* clientIndex)
+// Shortens timeoutMs so poll() returns by the first buffered line that may
+// run and the next timer wheel step.
+int Server::pollTimeout(int timeoutMs) const
 {
-    (void)clientIndex;
-    debugLog("Erasing client with FD " + std::to_string(clientFd));
-    // Find the client index
-    size_t index = 0;
-    for (auto it = _clients.begin(); it != _clients.end(); ++it, ++index)
+    uint64_t firstNs = _timers.nextWakeNs();
+    for (const auto& entry : _linesWaiting) firstNs = std::min(firstNs, entry.second);
+    if (firstNs == UINT64_MAX)
+        return timeoutMs;
+    uint64_t nowNs = io().nowNs();
+    if (firstNs <= nowNs)
+        return 0;
+    uint64_t waitMs = (firstNs - nowNs + 999999) / 1000000;
+    if (timeoutMs >= 0 && static_cast<uint64_t>(timeoutMs) < waitMs)
+        return timeoutMs;
+    return static_cast<int>(std::min<uint64_t>(waitMs, INT32_MAX));
+}
+
+// Runs the buffered lines of clients whose wait is over; returns how many
+// clients that was.
+int Server::processWaitingLines()
+{
+    if (_linesWaiting.empty())
+        return 0;
+    uint64_t nowNs = io().nowNs();
+    std::vector<int> fds;
+    for (const auto& entry : _linesWaiting)
     {
-        if (it->getFd() == clientFd)
-        {
-            // Remove the client from _clients vector
-            _clients.erase(it);
+        if (entry.second <= nowNs)
+            fds.push_back(entry.first);
+    }
+    std::sort(fds.begin(), fds.end());  // same order on every run
+    for (int fd : fds)
+    {
+        // Entries go when their connection does, so fd is still open.
+        _linesWaiting.erase(fd);
+        TraceSample sample(fd);
+        processLines(fd);
+    }
+    return static_cast<int>(fds.size());
+}
 
-            // Update the client index
-            if (clientIndex)
-                (*clientIndex)--;
+// Tells the client why with ERROR and runs the QUIT path with reason.
+void Server::sendClosing(int fd, const std::string& reason)
+{
+    Client* client = getClientObjByFd(fd);
 
-            break;
-        }
+    // Around the send queue: it may be full, and nothing queued would be
+    // written anyway. Best effort, and only when nothing is queued, so the
+    // ERROR never lands in the middle of a partly written line.
+    if (g_sendQueues.pending(fd) == 0)
+    {
+        std::string error = "ERROR :Closing Link: " +
+                            (client ? client->getIPa() : std::string("*")) + " (" + reason + ")\r\n";
+        io().send(fd, error.data(), error.size());
     }
 
-    // Remove empty channels
-    removeEmptyChannels();
+    if (client)
+        executeQuit(*this, fd, "QUIT :" + reason);
 }
 
-bool Server::isRegistered(int clientFd)
+void Server::closeLink(int fd, size_t index, const std::string& reason)
 {
-    for (auto it = _clients.begin(); it != _clients.end(); ++it)
+    sendClosing(fd, reason);
+    releaseConnection(fd, index);
+}
+
+// closeLink for many connections, with one pass over _poll_fds rather than
+// a search per fd.
+void Server::closeLinks(const std::vector<int>& fds, const std::string& reason)
+{
+    for (int fd : fds) sendClosing(fd, reason);
+    dropConnections(fds);
+}
+
+// Closes fd at the end of this tick. For links refused while their lines
+// are being dispatched, where the caller still holds the poll index.
+void Server::closeLater(int fd)
+{
+    _closeQueue.push_back(fd);
+}
+
+// releaseConnection for many connections, with one pass over _poll_fds.
+void Server::dropConnections(const std::vector<int>& fds)
+{
+    std::unordered_set<int> closing(fds.begin(), fds.end());
+    _poll_fds.erase(std::remove_if(_poll_fds.begin(), _poll_fds.end(),
+                                   [&](const pollfd& pfd)
+                                   {
+                                       if (!closing.count(pfd.fd))
+                                           return false;
+                                       forgetConnection(pfd.fd);
+                                       return true;
+                                   }),
+                    _poll_fds.end());
+}
+
+// Closes the socket and drops its poll slot, buffers and queues. The Client
+// itself is left to the caller.
+void Server::releaseConnection(int fd, size_t index)
+{
+    forgetConnection(fd);
+    _poll_fds.erase(_poll_fds.begin() + index);
+}
+
+// releaseConnection without the poll slot.
+void Server::forgetConnection(int fd)
+{
+    _capture.disconnect(fd);
+    g_sendQueues.close(fd);
+    _flood.close(fd);
+    _timers.cancel(fd);
+    _ipLimits.release(fd, io().nowNs());
+    io().close(fd);
+    _recvBuffers.erase(fd);
+    _readPaused.erase(fd);
+    _linesWaiting.erase(fd);
+    // Already closed: a descriptor reused later this tick must not be.
+    if (!_closeQueue.empty())
+        _closeQueue.erase(std::remove(_closeQueue.begin(), _closeQueue.end(), fd),
+                          _closeQueue.end());
+}
+
+// Arms fd's keepalive timer, replacing its registration deadline.
+void Server::armKeepalive(int fd)
+{
+    if (_config.pingInterval > 0)
+        _timers.schedule(fd, io().nowNs() + _config.pingInterval * kNsPerSecond);
+    else
+        _timers.cancel(fd);
+}
+
+// Keepalive. A connection's timer is due pingInterval after its last
+// activity, as of when it was armed; reads only update the Client's
+// timestamp, and the timer is pushed back when it fires early. A silent
+// connection is sent a PING and gets pingTimeout to say anything at all.
+// Connections whose Client is gone (QUIT, waiting for the hangup) are
+// closed when their timer fires. Until a connection registers its timer is
+// the registration deadline instead, and firing closes it.
+void Server::expireTimers()
+{
+    std::vector<int> due;
+    const uint64_t nowNs = io().nowNs();
+    _timers.expire(nowNs, due);
+    if (due.empty())
+        return;
+
+    std::vector<int> dead;
+    std::vector<int> unregistered;
+    for (int fd : due)
     {
-        if (it->getFd() == clientFd)
-            return it->isRegistered();
+        Client* client = getClientObjByFd(fd);
+        if (!client)
+        {
+            dead.push_back(fd);
+            continue;
+        }
+        if (!client->isRegistered() && _config.registrationTimeout > 0)
+        {
+            unregistered.push_back(fd);
+            continue;
+        }
+        uint64_t idleAtNs = client->getLastActivity() + _config.pingInterval * kNsPerSecond;
+        if (idleAtNs > nowNs)
+            _timers.schedule(fd, idleAtNs);
+        else if (!client->isPingPending())
+        {
+            sendMessage(fd, "PING :ft_irc\r\n");
+            client->setPingPending(true);
+            _metrics.pingsSent++;
+            _timers.schedule(fd, nowNs + _config.pingTimeout * kNsPerSecond);
+        }
+        else
+            dead.push_back(fd);
     }
-    return false;
+    if (!unregistered.empty())
+    {
+        _metrics.registrationFailures[REG_TIMEOUT] += unregistered.size();
+        std::cerr << "[WARN] Registration timeout: closing " << unregistered.size()
+                  << " connection(s)" << std::endl;
+        closeLinks(unregistered, "Registration timeout");
+    }
+    if (dead.empty())
+        return;
+    _metrics.pingTimeouts += dead.size();
+    std::cerr << "[WARN] Ping timeout: closing " << dead.size() << " connection(s)" << std::endl;
+    closeLinks(dead, "Ping timeout: " +
+                         std::to_string(_config.pingInterval + _config.pingTimeout) + " seconds");
 }
 
-bool Server::isUniqueNick(std::string nick)
+void Server::eraseClient(int clientFd, size_t* clientIndex)
 {
-    for (auto it = _clients.begin(); it != _clients.end(); ++it)
+    debugLog("Erasing client with FD " + std::to_string(clientFd));
+    std::unordered_map<int, std::list<Client>::iterator>::iterator found =
+        _clientsByFd.find(clientFd);
+    if (found != _clientsByFd.end())
     {
-        if (it->getNick() == nick)
-            return false;
+        std::unordered_map<std::string, unsigned>::iterator nick =
+            _nickCounts.find(found->second->getNick());
+        if (nick != _nickCounts.end() && --nick->second == 0)
+            _nickCounts.erase(nick);
+        if (!found->second->isRegistered())
+            --_unregistered;
+        _clients.erase(found->second);
+        _clientsByFd.erase(found);
+
+        // Update the client index
+        if (clientIndex)
+            (*clientIndex)--;
     }
-    return true;
+
+    // Remove empty channels
+    removeEmptyChannels();
 }
 
-void Server::addClient(const Client& client) { _clients.push_back(client); }
+bool Server::isRegistered(int clientFd)
+{
+    Client* client = getClientObjByFd(clientFd);
+    return client && client->isRegistered();
+}
+
+bool Server::isUniqueNick(std::string nick) { return _nickCounts.find(nick) == _nickCounts.end(); }
+
+void Server::renameClient(Client& client, const std::string& nick)
+{
+    std::unordered_map<std::string, unsigned>::iterator old = _nickCounts.find(client.getNick());
+    if (old != _nickCounts.end() && --old->second == 0)
+        _nickCounts.erase(old);
+    client.setNickname(nick);
+    _nickCounts[nick]++;
+}
+
+void Server::addClient(const Client& client)
+{
+    _clients.push_back(client);
+    indexClient(std::prev(_clients.end()));
+}
+
+void Server::indexClient(std::list<Client>::iterator it)
+{
+    _clientsByFd[it->getFd()] = it;
+    _nickCounts[it->getNick()]++;
+}
 
 Client* Server::getClientObjByFd(int fd)
 {
-    for (auto& client : _clients)
-    {
-        if (client.getFd() == fd)
-            return &client;
-    }
-    return nullptr;
+    std::unordered_map<int, std::list<Client>::iterator>::iterator found = _clientsByFd.find(fd);
+    return found == _clientsByFd.end() ? nullptr : &*found->second;
 }
 
 Client* Server::getClientObjByNick(const std::string& nick)
 {
+    PROF_SCOPE("getClientObjByNick");
     std::string target = ircCaseFold(nick);
     for (auto it = _clients.begin(); it != _clients.end(); ++it)
     {
@@ -245,81 +634,100 @@ Client* Server::getClientObjByNick(const std::string& nick)
 
 size_t Server::getClientIndex(int clientFd)
 {
-    for (size_t i = 0; i < _clients.size(); ++i)
+    size_t index = 0;
+    for (auto it = _clients.begin(); it != _clients.end(); ++it, ++index)
     {
-        if (_clients[i].getFd() == clientFd)
-            return i;
+        if (it->getFd() == clientFd)
+            return index;
     }
     throw std::runtime_error("Client with fd " + std::to_string(clientFd) + " not found");
 }
 
 void Server::dispatchCommand(const std::string& fullMessage, int clientFd)
 {
+    PROF_SCOPE("dispatchCommand");
     std::istringstream stream(fullMessage);
     std::string line;
     while (std::getline(stream, line))
     {
+        uint64_t startNs = monotonicNs();
+        ALLOC_SCOPE(ALLOC_PARSE, clientFd);
+        TraceSpan dispatchSpan("dispatch", clientFd);
+
         if (!line.empty() && line.back() == '\r')
             line.pop_back();
         if (!line.empty() && line[0] == ':')
             continue;
 
         std::vector<std::string> tokens;
-        parser(line, tokens, ' ');
-        if (tokens.empty())
-            continue;
-
-        //        const std::string& command = tokens[0];
-        std::string command = toUpperCase(tokens[0]);
-
-        if (command == "NICK")
-        {
-            executeNick(*this, clientFd, line);
-        }
-        else if (command == "JOIN")
-        {
-            handleJoin(clientFd, line);
-        }
-        else if (command == "PART")
+        std::string command;
+        CommandId id;
         {
-            handlePart(clientFd, line);
+            TraceSpan parseSpan("parse", clientFd);
+            parser(line, tokens, ' ');
+            if (tokens.empty())
+                continue;
+
+            //        const std::string& command = tokens[0];
+            command = toUpperCase(tokens[0]);
+            id = commandIdFor(command);
+            ALLOC_RETAG(id);
         }
-        else if (command == "PRIVMSG" || command == "MSG")
-        {
-            executePrivmsg(*this, clientFd, line);
-        }
-        else if (command == "NOTICE")
-        {
-            executeNotice(*this, clientFd, line);
-        }
-        else if (command == "QUIT")
-        {
-            executeQuit(*this, clientFd, line);
-        }
-        else if (command == "MODE")
-        {
-            executeMode(*this, clientFd, line);
-        }
-        else if (command == "TOPIC")
-        {
-            handleTopic(clientFd, line);
-        }
-        else if (command == "KICK")
-        {
-            handleKick(clientFd, line);
-        }
-        else if (command == "INVITE")
-        {
-            handleInvite(clientFd, line);
-        }
-        else if (command == "PING")
-        {
-            executePing(*this, clientFd, line);
-        }
-        else
+        if ((id == CMD_PRIVMSG || id == CMD_NOTICE || id == CMD_TOPIC) &&
+            !checkCharset(line, clientFd, id))
+            continue;
+        _metrics.commandsDispatched++;
+        g_tracer.setCommand(commandName(id));
+        IRC_PROBE2(command__start, clientFd, commandName(id));
+
+        TraceSpan handlerSpan("handler", clientFd);
+        switch (id)
         {
-            sendError(clientFd, "421", command, ":Unknown command");
+            case CMD_NICK:
+                executeNick(*this, clientFd, line);
+                break;
+            case CMD_JOIN:
+                handleJoin(clientFd, line);
+                break;
+            case CMD_PART:
+                handlePart(clientFd, line);
+                break;
+            case CMD_PRIVMSG:
+                executePrivmsg(*this, clientFd, line);
+                break;
+            case CMD_NOTICE:
+                executeNotice(*this, clientFd, line);
+                break;
+            case CMD_QUIT:
+                executeQuit(*this, clientFd, line);
+                break;
+            case CMD_MODE:
+                executeMode(*this, clientFd, line);
+                break;
+            case CMD_TOPIC:
+                handleTopic(clientFd, line);
+                break;
+            case CMD_KICK:
+                handleKick(clientFd, line);
+                break;
+            case CMD_INVITE:
+                handleInvite(clientFd, line);
+                break;
+            case CMD_PING:
+                executePing(*this, clientFd, line);
+                break;
+            case CMD_PONG:
+                break;  // every read already counts as keepalive activity
+            default:
+                _metrics.unknownCommands++;
+                sendError(clientFd, "421", command, ":Unknown command");
+                break;
         }
+
+        uint64_t elapsedNs = monotonicNs() - startNs;
+        _metrics.commandLatency[id].record(elapsedNs);
+        IRC_PROBE3(command__done, clientFd, commandName(id), elapsedNs);
+        _metrics.ticks.recordHandler(commandName(id), clientFd, elapsedNs);
     }
 }
 
@@ -348,6 +756,25 @@ Channel* Server::createOrGetChannel(const std::string& name)
     return &_channels.back();
 }
 
+// Applies utf8_policy to a message line. Returns false when the line is
+// dropped; a repaired line is rewritten in place.
+bool Server::checkCharset(std::string& line, int clientFd, CommandId id)
+{
+    if (_config.utf8Policy == UTF8_OFF || isValidUtf8(line))
+        return true;
+    if (_config.utf8Policy == UTF8_REPAIR)
+    {
+        line = repairUtf8(line);
+        _metrics.utf8Repaired++;
+        return true;
+    }
+    _metrics.utf8Rejected++;
+    if (id != CMD_NOTICE)  // NOTICE is never answered
+        sendMessage(clientFd, std::string("FAIL ") + commandName(id) +
+                                  " INVALID_UTF8 :Message rejected, it was not valid UTF-8\r\n");
+    return false;
+}
+
 // Helper method to safely disconnect a client
 void Server::handleClientDisconnect(int clientFd, size_t* clientIndex)
 {
@@ -365,6 +792,7 @@ void Server::handleClientDisconnect(int clientFd, size_t* clientIndex)
 // Implementation of the parser function
 void Server::parser(std::string arg, std::vector<std::string>& params, char del)
 {
+    PROF_SCOPE("Server::parser");
     std::istringstream iss(arg);
     std::string token;
     while (std::getline(iss, token, del))
@@ -1,21 +1,38 @@
 #pragma once
 
 #include <poll.h>
-#include <deque>
+#include <csignal>
+#include <list>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include "Channel.hpp"
 #include "Client.hpp"
+#include "ServerConfig.hpp"
+#include "capture/CaptureWriter.hpp"
+#include "metrics/Metrics.hpp"
+#include "net/CidrTree.hpp"
+#include "net/FloodControl.hpp"
+#include "net/IpLimits.hpp"
+#include "net/TimerWheel.hpp"
+
+class ModeChanges;
 
 class Server {
 public:
-    Server(int port, std::string password, bool debugMode);
+    Server(int port, std::string password, bool debugMode,
+           const ServerConfig& config = ServerConfig());
     Server(const Server& other);
     Server& operator=(const Server& other);
     ~Server();
 
     void run();
+    // One event-loop iteration: poll with timeoutMs, then serve every ready
+    // fd and every resumed client with complete lines still buffered.
+    // Returns the number of fds served, or -1 if poll failed.
+    int tick(int timeoutMs);
+    // Async-signal-safe: makes run() return after the current tick.
+    static void requestShutdown();
     void acceptClient();
     void receiveData(int clientFd, size_t index);
     void dispatchCommand(const std::string& fullMessage, int clientFd);
@@ -32,15 +49,19 @@ public:
 
     bool isRegistered(int clientFd);
     bool isUniqueNick(std::string nick);
+    // Changes a client's nick; keeps the nick index in sync.
+    void renameClient(Client& client, const std::string& nick);
 
     inline int getPort() const { return _port; }
     inline std::string getPassword() const { return _password; }
 
+    // Registration (clientRegistration.cpp)
     void registerClient(int clientFd, const std::string& arg, size_t* clientIndex);
-    void registerPassword(Client& client, const std::string& arg, size_t* clientIndex);
-    void registerNickname(Client& client, const std::string& arg);
-    void registerUser(Client& client, const std::string& arg);
-    void authenticate(Client& client, const std::string& arg, size_t* clientIndex);
+    void registerPassword(Client& client, const std::vector<std::string>& params,
+                          size_t* clientIndex);
+    void registerNickname(Client& client, const std::vector<std::string>& params);
+    void registerUser(Client& client, const std::vector<std::string>& params);
+    void completeRegistration(Client& client, size_t* clientIndex);
 
     // Channel management
     Channel* getChannelByName(const std::string& name);
@@ -62,27 +83,68 @@ public:
 
     // MODE
     void setMode(int clientFd, std::vector<std::string>& params);
-    bool applyChannelMode(Client* client, Channel& channel,
-                          const std::string& flag,
-                          const std::vector<std::string>& params);
+    bool applyChannelMode(Client* client, Channel& channel, bool adding,
+                          char modeChar, const std::string* param,
+                          ModeChanges& changes);
 
     // Client disconnect helper
     void handleClientDisconnect(int clientFd, size_t* clientIndex);
     
+    // Splits arg on del, dropping empty tokens.
+    void parser(std::string arg, std::vector<std::string>& params, char del);
+
     // Debug helpers
     bool isDebugMode() const { return _debugMode; }
     void setDebugMode(bool mode) { _debugMode = mode; }
     void debugLog(const std::string& msg) const;
 
+    const ServerConfig& getConfig() const { return _config; }
+
+    // Admin endpoint (Prometheus metrics)
+    const ServerMetrics& getMetrics() const { return _metrics; }
+    std::string renderMetrics() const;
+
+    // Server bans (ServerBans.cpp). Adding one also closes the connections
+    // it matches; the admin endpoint's /dline and /kline routes call these.
+    bool isDlined(const sockaddr_in& addr) const;
+    bool isKlined(const Client& client) const;
+    bool addDline(uint32_t network, int bits);
+    bool addKline(const std::string& mask);
+    std::string renderBans() const;
+
 private:
     int _server_fd;
     int _port;
     std::string _password;
 
-    std::deque<Client> _clients;
+    std::list<Client> _clients;  // list: Channel keeps Client* across erases
+    std::unordered_map<int, std::list<Client>::iterator> _clientsByFd;
+    std::unordered_map<std::string, unsigned> _nickCounts;  // exact nick -> clients
     std::vector<pollfd> _poll_fds;
     std::vector<Channel> _channels;
     std::unordered_map<int, std::string> _recvBuffers;
+    // Clients not polled for POLLIN, mapped to the server-wide queued bytes
+    // that must drain before they are read again.
+    std::unordered_map<int, uint64_t> _readPaused;
+    // Clients with complete lines still buffered, mapped to the io() time
+    // at which they may run: 0 (next tick) after a pause or a spent line
+    // budget, the next token's due time when throttled.
+    std::unordered_map<int, uint64_t> _linesWaiting;
+    FloodControl _flood;
+    // Connections and connect rate per source address.
+    IpLimits _ipLimits;
+    // Server bans (ServerBans.cpp): D-lines by address, K-lines by
+    // user@host.
+    CidrTree _dlines;
+    MaskList _klines;
+    // Registration deadline, then keepalive deadline, per connection (see
+    // expireTimers).
+    TimerWheel _timers;
+    // Accepted connections that have not completed registration.
+    size_t _unregistered = 0;
+    // Fds whose Client is gone and whose socket closes at the end of the
+    // tick (wrong password, QUIT before registering).
+    std::vector<int> _closeQueue;
 
     // New unique client ID counter.
     int _nextClientId;
@@ -90,5 +152,57 @@ private:
     // Debug mode flag
     bool _debugMode;
 
-    void parser(std::string arg, std::vector<std::string>& params, char del);
+    static volatile sig_atomic_t _shutdownRequested;
+
+    ServerConfig _config;
+    ServerMetrics _metrics;
+    CaptureWriter _capture;
+
+    // Admin listener and its short-lived HTTP connections.
+    struct AdminConnection
+    {
+        std::string request;
+        std::string response;
+        long peerUid = -1;  // admin_socket peers only (SO_PEERCRED)
+    };
+    int _admin_fd;
+    std::unordered_map<int, AdminConnection> _adminConns;
+
+    void indexClient(std::list<Client>::iterator it);
+    bool admitAddress(int fd, const sockaddr_in& addr, const ConnectionClass& cls);
+    void releaseConnection(int fd, size_t index);
+    void sendClosing(int fd, const std::string& reason);
+    void closeLink(int fd, size_t index, const std::string& reason);
+    void closeLinks(const std::vector<int>& fds, const std::string& reason);
+    void closeLater(int fd);
+    void dropConnections(const std::vector<int>& fds);
+    void forgetConnection(int fd);
+    void processLines(int clientFd);
+    int pollTimeout(int timeoutMs) const;
+    void expireTimers();
+    void armKeepalive(int fd);
+    int processWaitingLines();
+    bool checkCharset(std::string& line, int clientFd, CommandId id);
+
+    // Server bans (ServerBans.cpp)
+    void loadBans();
+    void closeBanned(const std::vector<int>& fds, const std::string& reason);
+
+    // Output queues (ServerOutput.cpp)
+    void flushSendQueue(size_t index);
+    void watchBlockedQueues();
+    void dropSlowConsumers();
+    void dropSlowConsumer(int fd);
+    void pauseIfCongested(int clientFd, uint64_t queuedBefore, uint64_t submittedBefore);
+    void resumeReaders();
+
+    void openAdminEndpoint();
+    void acceptAdmin();
+    void handleAdminIO(int fd, size_t index, short revents);
+    void closeAdmin(int fd, size_t index);
+    std::string handleBanRequest(const std::string& method, const std::string& path,
+                                 const AdminConnection& conn);
+    void renderPerClass(std::string& out, const char* name, const char* help,
+                        const std::map<std::string, uint64_t>& counts) const;
+    void renderMemoryUsage(std::string& out) const;
 };
@@ -0,0 +1,456 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "Server.hpp"
+#include "metrics/MemoryUsage.hpp"
+#include "metrics/Prometheus.hpp"
+#include "net/SendQueue.hpp"
+
+// Requests larger than this are answered with 431 and dropped.
+static const size_t kMaxAdminRequest = 8192;
+
+void Server::openAdminEndpoint()
+{
+    if (_config.adminSocket.empty() && _config.adminPort == 0)
+        return;
+
+    if (!_config.adminSocket.empty())
+    {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (_config.adminSocket.size() >= sizeof(addr.sun_path))
+            throw std::runtime_error("admin_socket path is too long");
+        std::strcpy(addr.sun_path, _config.adminSocket.c_str());
+
+        _admin_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_admin_fd < 0)
+        {
+            perror("socket");
+            throw std::runtime_error("Failed to create admin socket");
+        }
+        unlink(addr.sun_path);  // stale socket from a previous run
+        // Connecting needs write permission on the socket file: owner only,
+        // since this socket can change the server bans.
+        mode_t oldMask = umask(0177);
+        int bound = bind(_admin_fd, (struct sockaddr*)&addr, sizeof(addr));
+        umask(oldMask);
+        if (bound < 0)
+        {
+            perror("bind");
+            throw std::runtime_error("Failed to bind admin socket");
+        }
+    }
+    else
+    {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(_config.adminPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // never exposed externally
+
+        _admin_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (_admin_fd < 0)
+        {
+            perror("socket");
+            throw std::runtime_error("Failed to create admin socket");
+        }
+        int opt = 1;
+        setsockopt(_admin_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (bind(_admin_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        {
+            perror("bind");
+            throw std::runtime_error("Failed to bind admin port");
+        }
+    }
+
+    if (fcntl(_admin_fd, F_SETFL, O_NONBLOCK) < 0 || listen(_admin_fd, 16) < 0)
+    {
+        perror("listen");
+        throw std::runtime_error("Failed to listen on admin endpoint");
+    }
+
+    pollfd pfd = {};
+    pfd.fd = _admin_fd;
+    pfd.events = POLLIN;
+    _poll_fds.push_back(pfd);
+
+    std::cout << "[INFO] Admin endpoint listening on "
+              << (_config.adminSocket.empty() ? "127.0.0.1:" + std::to_string(_config.adminPort)
+                                              : _config.adminSocket)
+              << std::endl;
+}
+
+void Server::acceptAdmin()
+{
+    int fd = accept(_admin_fd, nullptr, nullptr);
+    if (fd < 0)
+    {
+        perror("accept");
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    AdminConnection conn;
+    ucred peer = {};
+    socklen_t peerLen = sizeof(peer);
+    if (!_config.adminSocket.empty() &&
+        getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peerLen) == 0)
+        conn.peerUid = peer.uid;
+    _adminConns[fd] = conn;
+    pollfd pfd = {};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    _poll_fds.push_back(pfd);
+}
+
+void Server::closeAdmin(int fd, size_t index)
+{
+    close(fd);
+    _adminConns.erase(fd);
+    _poll_fds.erase(_poll_fds.begin() + index);
+}
+
+static std::string httpResponse(const std::string& status, const std::string& contentType,
+                                const std::string& body)
+{
+    return "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" +
+           body;
+}
+
+// Reads the request until the header terminator, then answers once and closes.
+// Never blocks: partial reads and writes simply wait for the next poll round.
+void Server::handleAdminIO(int fd, size_t index, short revents)
+{
+    AdminConnection& conn = _adminConns[fd];
+
+    if ((revents & POLLIN) && conn.response.empty())
+    {
+        char buffer[1024];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            closeAdmin(fd, index);
+            return;
+        }
+        conn.request.append(buffer, n);
+
+        if (conn.request.size() > kMaxAdminRequest)
+            conn.response =
+                httpResponse("431 Request Header Fields Too Large", "text/plain", "too large\n");
+        else if (conn.request.find("\r\n\r\n") == std::string::npos &&
+                 conn.request.find("\n\n") == std::string::npos)
+            return;
+        else
+        {
+            _metrics.adminRequests++;
+            std::string requestLine = conn.request.substr(0, conn.request.find_first_of("\r\n"));
+            std::string method = requestLine.substr(0, requestLine.find(' '));
+            std::string path = requestLine.size() > method.size()
+                                   ? requestLine.substr(method.size() + 1)
+                                   : std::string();
+            path = path.substr(0, path.find(' '));
+            if (method == "GET" && path == "/metrics")
+                conn.response = httpResponse(
+                    "200 OK", "text/plain; version=0.0.4; charset=utf-8", renderMetrics());
+            else if (path == "/bans" || path.rfind("/dline/", 0) == 0 ||
+                     path.rfind("/kline/", 0) == 0)
+                conn.response = handleBanRequest(method, path, conn);
+            else
+                conn.response = httpResponse("404 Not Found", "text/plain", "not found\n");
+        }
+        _poll_fds[index].events = POLLOUT;
+    }
+    else if (revents & (POLLHUP | POLLERR))
+    {
+        closeAdmin(fd, index);
+        return;
+    }
+
+    if (!conn.response.empty())
+    {
+        ssize_t n = send(fd, conn.response.data(), conn.response.size(), MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                closeAdmin(fd, index);
+            return;
+        }
+        conn.response.erase(0, n);
+        if (conn.response.empty())
+            closeAdmin(fd, index);
+    }
+}
+
+// %XX escapes in a request path, so a K-line mask can carry '?' and spaces
+// are never part of it.
+static std::string percentDecode(const std::string& text)
+{
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] == '%' && i + 2 < text.size() &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2])))
+        {
+            out += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            out += text[i];
+    }
+    return out;
+}
+
+// GET /bans lists the server bans. POST adds and DELETE removes one:
+// /dline/<address>[/<bits>] or /kline/<user>@<host>. Changes need
+// admin_bans_writable and a peer on admin_socket; each is logged with the
+// peer's uid, and none outlives the process.
+std::string Server::handleBanRequest(const std::string& method, const std::string& path,
+                                     const AdminConnection& conn)
+{
+    if (path == "/bans")
+    {
+        if (method != "GET")
+            return httpResponse("405 Method Not Allowed", "text/plain", "use GET\n");
+        return httpResponse("200 OK", "text/plain", renderBans());
+    }
+    if (method != "POST" && method != "DELETE")
+        return httpResponse("405 Method Not Allowed", "text/plain", "use POST or DELETE\n");
+    if (!_config.adminBansWritable || conn.peerUid < 0)
+        return httpResponse("403 Forbidden", "text/plain",
+                            "ban changes need admin_bans_writable and admin_socket\n");
+
+    const bool adding = method == "POST";
+    std::string target = percentDecode(path.substr(std::string("/dline/").size()));
+    bool changed;
+    if (path[1] == 'd')
+    {
+        uint32_t network;
+        int bits;
+        if (!parseCidr(target, network, bits))
+            return httpResponse("400 Bad Request", "text/plain", "expected <address>[/<bits>]\n");
+        changed = adding ? addDline(network, bits) : _dlines.erase(network, bits);
+    }
+    else
+    {
+        if (target.find('@') == std::string::npos || target.find(' ') != std::string::npos)
+            return httpResponse("400 Bad Request", "text/plain", "expected <user>@<host>\n");
+        changed = adding ? addKline(target) : _klines.remove(MaskList::canonical(target));
+    }
+    if (!changed)
+        return httpResponse(adding ? "409 Conflict" : "404 Not Found", "text/plain",
+                            adding ? "already banned\n" : "no such ban\n");
+    std::cout << "[INFO] admin uid " << conn.peerUid << ": " << method << " " << path
+              << std::endl;
+    return httpResponse("200 OK", "text/plain", adding ? "added\n" : "removed\n");
+}
+
+std::string Server::renderMetrics() const
+{
+    std::string out;
+
+    prom::counter(out, "ircserv_connections_accepted_total", "Client connections accepted.",
+                  _metrics.connectionsAccepted);
+    prom::counter(out, "ircserv_connections_closed_total", "Client connections closed by peer.",
+                  _metrics.connectionsClosed);
+    prom::counter(out, "ircserv_registrations_total", "Clients that completed registration.",
+                  _metrics.registrationsCompleted);
+    prom::header(out, "ircserv_registration_failures_total", "counter",
+                 "Refused registration steps and connections closed before registering, per "
+                 "reason.");
+    for (int reason = 0; reason < REG_FAILURE_COUNT; ++reason)
+        prom::sample(out, "ircserv_registration_failures_total",
+                     std::string("reason=\"") +
+                         registrationFailureName(RegistrationFailure(reason)) + "\"",
+                     _metrics.registrationFailures[reason]);
+    prom::counter(out, "ircserv_received_bytes_total", "Bytes read from client sockets.",
+                  _metrics.bytesReceived);
+    prom::counter(out, "ircserv_received_lines_total", "Complete lines read from clients.",
+                  _metrics.linesReceived);
+    prom::counter(out, "ircserv_commands_total", "Commands dispatched from registered clients.",
+                  _metrics.commandsDispatched);
+    prom::counter(out, "ircserv_unknown_commands_total", "Commands answered with 421.",
+                  _metrics.unknownCommands);
+    prom::header(out, "ircserv_command_duration_seconds", "summary",
+                 "End-to-end dispatchCommand latency per command.");
+    for (int id = 0; id < CMD_COUNT; ++id)
+        prom::summary(out, "ircserv_command_duration_seconds",
+                      std::string("command=\"") + commandName(CommandId(id)) + "\"",
+                      _metrics.commandLatency[id], 1e-9);
+
+    const TickProfiler& ticks = _metrics.ticks;
+    prom::counter(out, "ircserv_ticks_total", "Event loop iterations.", ticks.ticks());
+    prom::counter(out, "ircserv_slow_ticks_total", "Ticks whose processing exceeded slow_tick_ms.",
+                  ticks.slowTicks());
+    prom::header(out, "ircserv_tick_poll_seconds", "summary", "Time spent blocked in poll().");
+    prom::summary(out, "ircserv_tick_poll_seconds", "", ticks.pollTime, 1e-9);
+    prom::header(out, "ircserv_tick_process_seconds", "summary",
+                 "Time spent handling ready fds after poll() returned.");
+    prom::summary(out, "ircserv_tick_process_seconds", "", ticks.processTime, 1e-9);
+    prom::header(out, "ircserv_tick_max_handler_seconds", "summary",
+                 "Longest single command handler per tick.");
+    prom::summary(out, "ircserv_tick_max_handler_seconds", "", ticks.maxHandlerTime, 1e-9);
+    prom::header(out, "ircserv_tick_ready_fds", "summary", "Ready fds reported by poll().");
+    prom::summary(out, "ircserv_tick_ready_fds", "", ticks.readyFds, 1.0);
+    prom::header(out, "ircserv_tick_lines", "summary", "Lines dispatched per tick.");
+    prom::summary(out, "ircserv_tick_lines", "", ticks.linesPerTick, 1.0);
+
+    prom::counter(out, "ircserv_admin_requests_total", "Requests served by the admin endpoint.",
+                  _metrics.adminRequests);
+
+    size_t registered = 0;
+    for (const Client& client : _clients)
+        if (client.isRegistered())
+            ++registered;
+    size_t memberships = 0;
+    for (const Channel& channel : _channels)
+        memberships += channel.getClients().size();
+    size_t pendingBytes = 0;
+    for (const auto& entry : _recvBuffers)
+        pendingBytes += entry.second.size();
+
+    prom::gauge(out, "ircserv_clients", "Connected clients.", _clients.size());
+    prom::gauge(out, "ircserv_clients_registered", "Connected clients that are registered.",
+                registered);
+    prom::gauge(out, "ircserv_clients_unregistered",
+                "Accepted connections still registering (max_unregistered applies).",
+                _unregistered);
+    prom::gauge(out, "ircserv_channels", "Existing channels.", _channels.size());
+    prom::gauge(out, "ircserv_channel_memberships", "Sum of channel member counts.", memberships);
+    prom::gauge(out, "ircserv_poll_fds", "File descriptors in the poll set.", _poll_fds.size());
+    prom::gauge(out, "ircserv_recv_buffered_bytes", "Unprocessed bytes in receive buffers.",
+                pendingBytes);
+
+    prom::gauge(out, "ircserv_sendq_bytes", "Bytes waiting in client send queues.",
+                g_sendQueues.queuedBytes());
+    prom::gauge(out, "ircserv_sendq_peak_bytes", "High watermark of ircserv_sendq_bytes.",
+                g_sendQueues.peakQueuedBytes());
+    prom::gauge(out, "ircserv_sendq_connection_peak_bytes",
+                "Largest send queue any single connection has reached.",
+                g_sendQueues.peakConnectionBytes());
+    prom::counter(out, "ircserv_sendq_dropped_bytes_total",
+                  "Output discarded because the connection's send queue was full.",
+                  g_sendQueues.droppedBytes());
+    prom::counter(out, "ircserv_read_pauses_total",
+                  "Times a client stopped being read because of output backpressure.",
+                  _metrics.readPauses);
+    prom::gauge(out, "ircserv_read_paused_clients", "Clients currently not being read.",
+                _readPaused.size());
+    renderPerClass(out, "ircserv_sendq_exceeded_total",
+                   "Connections closed with Max SendQ exceeded, per connection class.",
+                   _metrics.sendQExceeded);
+    prom::counter(out, "ircserv_flood_deferred_total",
+                  "Times a client's next line waited for its command group's tokens.",
+                  _metrics.floodDeferred);
+    prom::counter(out, "ircserv_line_budget_deferred_total",
+                  "Times a connection used its per-tick line budget and continued next tick.",
+                  _metrics.budgetDeferred);
+    prom::counter(out, "ircserv_ip_limit_refused_total",
+                  "Connections refused because their address had max_per_ip open.",
+                  _metrics.ipLimitRefused);
+    prom::counter(out, "ircserv_connect_throttled_total",
+                  "Connections refused because their address exceeded connect_rate.",
+                  _metrics.connectThrottled);
+    prom::counter(out, "ircserv_dline_refused_total", "Connections refused at accept by a D-line.",
+                  _metrics.dlineRefused);
+    prom::header(out, "ircserv_server_bans", "gauge", "Server bans in force, per type.");
+    prom::sample(out, "ircserv_server_bans", "type=\"dline\"", uint64_t(_dlines.size()));
+    prom::sample(out, "ircserv_server_bans", "type=\"kline\"", uint64_t(_klines.size()));
+    prom::gauge(out, "ircserv_ip_limit_entries", "Source addresses tracked by the per-address limits.",
+                _ipLimits.size());
+    prom::counter(out, "ircserv_utf8_rejected_total",
+                  "Message lines dropped for invalid UTF-8 (utf8_policy = reject).",
+                  _metrics.utf8Rejected);
+    prom::counter(out, "ircserv_utf8_repaired_total",
+                  "Message lines with invalid UTF-8 replaced by U+FFFD (utf8_policy = repair).",
+                  _metrics.utf8Repaired);
+    prom::counter(out, "ircserv_pings_sent_total", "Keepalive PINGs sent to silent connections.",
+                  _metrics.pingsSent);
+    prom::counter(out, "ircserv_ping_timeouts_total",
+                  "Connections closed by the keepalive timer.", _metrics.pingTimeouts);
+    prom::gauge(out, "ircserv_timers_armed", "Connections with a registration or keepalive timer.",
+                _timers.size());
+    renderPerClass(out, "ircserv_excess_flood_total",
+                   "Connections closed with Excess Flood, per connection class.",
+                   _metrics.excessFlood);
+
+    renderMemoryUsage(out);
+
+    return out;
+}
+
+// One counter sample per configured connection class, zeros included.
+void Server::renderPerClass(std::string& out, const char* name, const char* help,
+                            const std::map<std::string, uint64_t>& counts) const
+{
+    prom::header(out, name, "counter", help);
+    std::vector<const ConnectionClass*> classes(1, &_config.defaultClass);
+    for (const ConnectionClass& cls : _config.connectionClasses) classes.push_back(&cls);
+    for (const ConnectionClass* cls : classes)
+    {
+        std::map<std::string, uint64_t>::const_iterator it = counts.find(cls->name);
+        prom::sample(out, name, "class=\"" + cls->name + "\"",
+                     it == counts.end() ? 0 : it->second);
+    }
+}
+
+void Server::renderMemoryUsage(std::string& out) const
+{
+    size_t clientStrings = 0;
+    for (const Client& client : _clients) clientStrings += client.stringBytes();
+
+    // Node plus cached hash for the string-keyed nick index.
+    size_t clientIndex = (_clientsByFd.bucket_count() + _nickCounts.bucket_count()) *
+                             sizeof(void*) +
+                         _clientsByFd.size() * (kHashNodeOverhead + sizeof(*_clientsByFd.begin()));
+    for (const auto& entry : _nickCounts)
+        clientIndex += kHashNodeOverhead + sizeof(size_t) + sizeof(entry) +
+                       stringHeapBytes(entry.first);
+
+    size_t recvBuffers = _recvBuffers.bucket_count() * sizeof(void*);
+    for (const auto& entry : _recvBuffers)
+        recvBuffers += kHashNodeOverhead + sizeof(entry) + stringHeapBytes(entry.second);
+
+    size_t channelVectors = 0;
+    size_t inviteMaps = 0;
+    size_t maskLists = 0;
+    for (const Channel& channel : _channels)
+    {
+        channelVectors += channel.memberListBytes();
+        inviteMaps += channel.inviteListBytes();
+        maskLists += channel.maskListBytes();
+    }
+
+    const char* name = "ircserv_memory_bytes";
+    prom::header(out, name, "gauge",
+                 "Estimated heap bytes per structure (excludes allocator overhead).");
+    prom::sample(out, name, "structure=\"client_objects\"",
+                 uint64_t(_clients.size() * (sizeof(Client) + kListNodeOverhead)));
+    prom::sample(out, name, "structure=\"client_strings\"", uint64_t(clientStrings));
+    prom::sample(out, name, "structure=\"client_index\"", uint64_t(clientIndex));
+    prom::sample(out, name, "structure=\"recv_buffers\"", uint64_t(recvBuffers));
+    prom::sample(out, name, "structure=\"send_queues\"", uint64_t(g_sendQueues.heapBytes()));
+    prom::sample(out, name, "structure=\"flood_buckets\"", uint64_t(_flood.heapBytes()));
+    prom::sample(out, name, "structure=\"timer_wheel\"", uint64_t(_timers.heapBytes()));
+    prom::sample(out, name, "structure=\"ip_limits\"", uint64_t(_ipLimits.heapBytes()));
+    prom::sample(out, name, "structure=\"server_bans\"",
+                 uint64_t(_dlines.heapBytes() + _klines.heapBytes()));
+    prom::sample(out, name, "structure=\"poll_fds\"",
+                 uint64_t(_poll_fds.capacity() * sizeof(pollfd)));
+    prom::sample(out, name, "structure=\"channel_objects\"",
+                 uint64_t(_channels.capacity() * sizeof(Channel)));
+    prom::sample(out, name, "structure=\"channel_vectors\"", uint64_t(channelVectors));
+    prom::sample(out, name, "structure=\"invite_maps\"", uint64_t(inviteMaps));
+    prom::sample(out, name, "structure=\"mask_lists\"", uint64_t(maskLists));
+}
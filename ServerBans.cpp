@@ -0,0 +1,106 @@
+#include <arpa/inet.h>
+
+#include <ctime>
+#include <iostream>
+
+#include "Server.hpp"
+#include "utils.hpp"
+
+// Server bans. D-lines are checked in acceptClient before anything is
+// allocated for the connection, K-lines in completeRegistration once the
+// username is known. Bans added at run time (through the admin endpoint)
+// also close the matching connections already open.
+
+static std::string formatCidr(uint32_t network, int bits)
+{
+    in_addr addr;
+    addr.s_addr = htonl(network);
+    char text[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr, text, sizeof(text));
+    return std::string(text) + "/" + std::to_string(bits);
+}
+
+// The config's bans, loaded once at startup.
+void Server::loadBans()
+{
+    for (const std::string& dline : _config.dlines)
+    {
+        uint32_t network;
+        int bits;
+        if (parseCidr(dline, network, bits))
+            _dlines.insert(network, bits);
+    }
+    for (const std::string& kline : _config.klines)
+        _klines.add(MaskList::canonical(kline), "config", std::time(nullptr));
+}
+
+bool Server::isDlined(const sockaddr_in& addr) const
+{
+    return _dlines.contains(ntohl(addr.sin_addr.s_addr));
+}
+
+// K-lines match the user and host other clients see, ~user@ip.
+bool Server::isKlined(const Client& client) const
+{
+    return !_klines.empty() &&
+           _klines.matches(ircCaseFold(client.getNick()), ircCaseFold("~" + client.getUser()),
+                           client.getIPa());
+}
+
+bool Server::addDline(uint32_t network, int bits)
+{
+    if (!_dlines.insert(network, bits))
+        return false;
+
+    const uint32_t mask = bits == 0 ? 0 : 0xffffffffu << (32 - bits);
+    std::vector<int> banned;
+    for (const Client& client : _clients)
+    {
+        in_addr addr;
+        if (inet_pton(AF_INET, client.getIPa().c_str(), &addr) == 1 &&
+            (ntohl(addr.s_addr) & mask) == network)
+            banned.push_back(client.getFd());
+    }
+    closeBanned(banned, "D-lined");
+    std::cout << "[INFO] D-line added: " << formatCidr(network, bits) << ", " << banned.size()
+              << " connection(s) closed" << std::endl;
+    return true;
+}
+
+bool Server::addKline(const std::string& mask)
+{
+    if (!_klines.add(MaskList::canonical(mask), "admin", std::time(nullptr)))
+        return false;
+
+    // Unregistered connections are checked when they complete registration.
+    std::vector<int> banned;
+    for (const Client& client : _clients)
+        if (client.isRegistered() && isKlined(client))
+            banned.push_back(client.getFd());
+    closeBanned(banned, "K-lined");
+    std::cout << "[INFO] K-line added: " << mask << ", " << banned.size()
+              << " connection(s) closed" << std::endl;
+    return true;
+}
+
+// Called from the admin handler, inside the poll loop: the clients go now,
+// their sockets at the end of the tick.
+void Server::closeBanned(const std::vector<int>& fds, const std::string& reason)
+{
+    for (int fd : fds)
+    {
+        sendClosing(fd, reason);
+        closeLater(fd);
+    }
+}
+
+// One ban per line: "dline <address>/<bits>" or "kline <mask> <set by> <time>".
+std::string Server::renderBans() const
+{
+    std::string out;
+    for (const std::pair<uint32_t, int>& prefix : _dlines.prefixes())
+        out += "dline " + formatCidr(prefix.first, prefix.second) + "\n";
+    for (const MaskList::Entry& entry : _klines.entries())
+        out += "kline " + entry.mask + " " + entry.setBy + " " + std::to_string(entry.setAt) + "\n";
+    return out;
+}
@@ -3,27 +3,31 @@
 #include "Server.hpp"
 #include "commands/join.hpp"
 #include "commands/nick.hpp"
+#include "metrics/ProfScope.hpp"
 #include "utils.hpp"
 
 // Find a channel by name
 Channel* Server::findChannel(const std::string& name)
 {
+    PROF_SCOPE("findChannel");
     std::string searchKey = ircCaseFold(trimWhitespace(name));
-    std::cout << "[findChannel] searchKey: '" << searchKey << "'\n";
-    debugLog("findChannel - Looking for '" + name + "'");
-    debugLog("findChannel - After trimming: '" + searchKey + "'");
+    if (_debugMode)
+    {
+        debugLog("findChannel - Looking for '" + name + "'");
+        debugLog("findChannel - After trimming: '" + searchKey + "'");
+    }
 
     for (size_t i = 0; i < _channels.size(); ++i)
     {
         std::string existingKey = ircCaseFold(_channels[i].getName());
 
-        std::cout << "[findChannel] checking: '" << existingKey << "'\n";
-        debugLog("Comparing with channel[" + std::to_string(i) + "] = '" + existingKey + "'");
+        // Per-channel tracing costs more than the lookup; debug mode only.
+        if (_debugMode)
+            debugLog("Comparing with channel[" + std::to_string(i) + "] = '" + existingKey + "'");
 
         if (existingKey == searchKey)
         {
             debugLog("findChannel - Match found!");
-            std::cout << "[findChannel] found match!\n";
             return &_channels[i];
         }
     }
@@ -115,6 +119,7 @@ void Server::removeClientFromChannels(int clientFd)
 // JOIN command handler
 void Server::handleJoin(int clientFd, const std::string& arg)
 {
+    PROF_SCOPE("handleJoin");
     Client* client = getClientObjByFd(clientFd);
     debugLog("handleJoin: fd=" + std::to_string(clientFd) + ", arg='" + arg + "'");
 
@@ -175,7 +180,16 @@ void Server::handleJoin(int clientFd, const std::string& arg)
         {
             debugLog("Channel found: '" + channelName + "'");
 
-            if (channel->isInviteOnly() && !channel->isInvited(client->getNick()))
+            if (channel->isBanned(client))
+            {
+                debugLog("Client matches a ban and no exception.");
+                sendError(clientFd, "474", client->getNick(),
+                          channelName + " :Cannot join channel (+b)");
+                continue;
+            }
+
+            if (channel->isInviteOnly() && !channel->isInvited(client->getNick()) &&
+                !channel->isInviteExempt(client))
             {
                 debugLog("Channel is invite-only and client not invited.");
                 sendError(clientFd, "473", client->getNick(),
@@ -224,28 +238,21 @@ void Server::handleJoin(int clientFd, const std::string& arg)
             {
                 std::string topicMsg = ":ft_irc 332 " + client->getNick() + " " + channelName +
                                        " :" + channel->getTopic() + "\r\n";
-                send(clientFd, topicMsg.c_str(), topicMsg.length(), 0);
+                sendMessage(clientFd, topicMsg);
             }
 
-            std::string namesMsg = ":ft_irc 353 " + client->getNick() + " = " + channelName + " :";
-            for (const auto& member : channel->getClients())
-            {
-                if (channel->isOperator(member))
-                    namesMsg += "@";
-                namesMsg += member->getNick() + " ";
-            }
-            namesMsg += "\r\n";
-            send(clientFd, namesMsg.c_str(), namesMsg.length(), 0);
+            std::string namesMsg = channel->namesReply(client->getNick());
+            sendMessage(clientFd, namesMsg);
 
             std::string endNamesMsg = ":ft_irc 366 " + client->getNick() + " " + channelName +
                                       " :End of /NAMES list.\r\n";
-            send(clientFd, endNamesMsg.c_str(), endNamesMsg.length(), 0);
+            sendMessage(clientFd, endNamesMsg);
 
             // INFO message
             std::string infoMsg = "[" + channelName + " INFO]: members: ";
             for (const auto& member : channel->getClients()) infoMsg += member->getNick() + " ";
             infoMsg += "\r\n";
-            send(clientFd, infoMsg.c_str(), infoMsg.length(), 0);
+            sendMessage(clientFd, infoMsg);
         }
         else
         {
@@ -254,21 +261,21 @@ void Server::handleJoin(int clientFd, const std::string& arg)
 
             std::string joinMsg = ":" + client->getNick() + "!~" + client->getUser() + "@" +
                                   client->getIPa() + " JOIN " + channelName + "\r\n";
-            send(clientFd, joinMsg.c_str(), joinMsg.length(), 0);
+            sendMessage(clientFd, joinMsg);
 
             std::string namesMsg = ":ft_irc 353 " + client->getNick() + " = " + channelName +
                                    " :@" + client->getNick() + "\r\n";
-            send(clientFd, namesMsg.c_str(), namesMsg.length(), 0);
+            sendMessage(clientFd, namesMsg);
 
             std::string endNamesMsg = ":ft_irc 366 " + client->getNick() + " " + channelName +
                                       " :End of /NAMES list.\r\n";
-            send(clientFd, endNamesMsg.c_str(), endNamesMsg.length(), 0);
+            sendMessage(clientFd, endNamesMsg);
 
             std::string infoMsg = "[" + channelName + " INFO]: members: ";
             // Only one member exists (the creator) so far:
             infoMsg += client->getNick() + " ";
             infoMsg += "\r\n";
-            send(clientFd, infoMsg.c_str(), infoMsg.length(), 0);
+            sendMessage(clientFd, infoMsg);
         }
     }
 }
@@ -432,12 +439,12 @@ void Server::handleInvite(int clientFd, const std::string& arg)
     // Send invite confirmation to sender
     std::string inviteReply =
         ":ft_irc 341 " + sender->getNick() + " " + targetNick + " " + channelName + "\r\n";
-    send(clientFd, inviteReply.c_str(), inviteReply.length(), 0);
+    sendMessage(clientFd, inviteReply);
 
     // Send invite notification to target
     std::string inviteMsg = ":" + sender->getNick() + "!~" + sender->getUser() + "@" +
                             sender->getIPa() + " INVITE " + targetNick + " " + channelName + "\r\n";
-    send(target->getFd(), inviteMsg.c_str(), inviteMsg.length(), 0);
+    sendMessage(target->getFd(), inviteMsg);
 }
 
 // KICK command handler
@@ -583,7 +590,7 @@ void Server::handleTopic(int clientFd, const std::string& arg)
             reply = ":ft_irc 332 " + client->getNick() + " " + channelName + " :" +
                     channel->getTopic() + "\r\n";
         }
-        send(clientFd, reply.c_str(), reply.size(), 0);
+        sendMessage(clientFd, reply);
         return;
     }
 
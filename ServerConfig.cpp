@@ -0,0 +1,298 @@
+#include "ServerConfig.hpp"
+
+#include <arpa/inet.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "utils.hpp"
+
+static int parseInt(const std::string& key, const std::string& value)
+{
+    try
+    {
+        size_t used = 0;
+        int result = std::stoi(value, &used);
+        if (used != value.size())
+            throw std::invalid_argument(value);
+        return result;
+    }
+    catch (const std::exception&)
+    {
+        throw std::runtime_error("Invalid integer for '" + key + "': " + value);
+    }
+}
+
+static int parsePositive(const std::string& key, const std::string& value)
+{
+    int result = parseInt(key, value);
+    if (result <= 0)
+        throw std::runtime_error("'" + key + "' must be positive");
+    return result;
+}
+
+static size_t parseBytes(const std::string& key, const std::string& value)
+{
+    try
+    {
+        size_t used = 0;
+        unsigned long long result = std::stoull(value, &used);
+        if (used != value.size() || result == 0 || value[0] == '-')
+            throw std::invalid_argument(value);
+        return static_cast<size_t>(result);
+    }
+    catch (const std::exception&)
+    {
+        throw std::runtime_error("Invalid byte count for '" + key + "': " + value);
+    }
+}
+
+static unsigned parseCount(const std::string& key, const std::string& value)
+{
+    int result = parseInt(key, value);
+    if (result < 0)
+        throw std::runtime_error("'" + key + "' must not be negative");
+    return static_cast<unsigned>(result);
+}
+
+static const char* const kFloodClassNames[FLOOD_CLASS_COUNT] = {"chat", "join", "mode",
+                                                                 "other"};
+
+// "<burst>/<per_second>", or "0" for unlimited
+static FloodLimit parseFloodLimit(const std::string& key, const std::string& value)
+{
+    if (value == "0")
+        return FloodLimit{1, 0};
+    size_t slash = value.find('/');
+    try
+    {
+        if (slash == std::string::npos)
+            throw std::invalid_argument(value);
+        size_t used = 0;
+        double burst = std::stod(value.substr(0, slash), &used);
+        if (used != slash)
+            throw std::invalid_argument(value);
+        std::string rate = value.substr(slash + 1);
+        double perSecond = std::stod(rate, &used);
+        if (used != rate.size() || burst < 1 || perSecond <= 0)
+            throw std::invalid_argument(value);
+        return FloodLimit{burst, perSecond};
+    }
+    catch (const std::exception&)
+    {
+        throw std::runtime_error("'" + key + "' expects <burst>/<per_second> or 0: " + value);
+    }
+}
+
+// Applies "recvq=<bytes>", "ip_max=<n>", "connect=<burst>/<per_second>" or
+// "<group>=<burst>/<per_second>" to cls.
+static void setClassOption(ConnectionClass& cls, const std::string& option)
+{
+    size_t eq = option.find('=');
+    std::string key = option.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+    if (key == "recvq")
+    {
+        cls.recvQ = parseBytes("connection_class recvq", value);
+        return;
+    }
+    if (key == "ip_max")
+    {
+        cls.maxPerIp = parseCount("connection_class ip_max", value);
+        return;
+    }
+    if (key == "connect")
+    {
+        cls.connectRate = parseFloodLimit("connection_class connect", value);
+        return;
+    }
+    for (int group = 0; group < FLOOD_CLASS_COUNT; ++group)
+    {
+        if (key == kFloodClassNames[group])
+        {
+            cls.flood[group] = parseFloodLimit("connection_class " + key, value);
+            return;
+        }
+    }
+    throw std::runtime_error("Unknown connection_class option: " + option);
+}
+
+bool parseCidr(const std::string& text, uint32_t& network, int& bits)
+{
+    size_t slash = text.find('/');
+    bits = 32;
+    if (slash != std::string::npos)
+    {
+        std::string length = text.substr(slash + 1);
+        if (length.empty() || length.size() > 2 ||
+            length.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        bits = std::stoi(length);
+    }
+    in_addr addr;
+    if (bits > 32 || inet_pton(AF_INET, text.substr(0, slash).c_str(), &addr) != 1)
+        return false;
+    network = ntohl(addr.s_addr) & (bits == 0 ? 0 : 0xffffffffu << (32 - bits));
+    return true;
+}
+
+// "<name> <address>/<bits> <sendq> [option]...", options as in setClassOption
+static ConnectionClass parseConnectionClass(const std::string& value,
+                                            const ConnectionClass& defaults)
+{
+    std::istringstream fields(value);
+    std::string name, network, sendQ, option;
+    if (!(fields >> name >> network >> sendQ))
+        throw std::runtime_error("connection_class expects <name> <address>/<bits> <sendq>: " +
+                                 value);
+
+    ConnectionClass result = defaults;
+    result.name = name;
+    int bits = 0;
+    if (!parseCidr(network, result.network, bits))
+        throw std::runtime_error("Invalid connection_class network: " + network);
+    result.mask = bits == 0 ? 0 : 0xffffffffu << (32 - bits);
+    result.sendQ = parseBytes("connection_class", sendQ);
+    while (fields >> option)
+        setClassOption(result, option);
+    return result;
+}
+
+const ConnectionClass& ServerConfig::classFor(const sockaddr_in& addr) const
+{
+    uint32_t host = ntohl(addr.sin_addr.s_addr);
+    for (const ConnectionClass& cls : connectionClasses)
+        if ((host & cls.mask) == cls.network)
+            return cls;
+    return defaultClass;
+}
+
+void ServerConfig::set(const std::string& key, const std::string& value)
+{
+    if (key == "admin_socket")
+        adminSocket = value;
+    else if (key == "admin_port")
+    {
+        adminPort = parseInt(key, value);
+        if (adminPort < 0 || adminPort > 65535)
+            throw std::runtime_error("admin_port must be between 0 and 65535");
+    }
+    else if (key == "admin_bans_writable")
+    {
+        int flag = parseInt(key, value);
+        if (flag != 0 && flag != 1)
+            throw std::runtime_error("admin_bans_writable must be 0 or 1");
+        adminBansWritable = flag == 1;
+    }
+    else if (key == "slow_tick_ms")
+        slowTickMs = parseInt(key, value);
+    else if (key == "trace_file")
+        traceFile = value;
+    else if (key == "trace_sample")
+        traceSample = static_cast<unsigned>(parsePositive(key, value));
+    else if (key == "trace_max_events")
+        traceMaxEvents = static_cast<uint64_t>(parsePositive(key, value));
+    else if (key == "capture_file")
+        captureFile = value;
+    else if (key == "sendq")
+        defaultClass.sendQ = parseBytes(key, value);
+    else if (key == "utf8_policy")
+    {
+        if (value == "off")
+            utf8Policy = UTF8_OFF;
+        else if (value == "reject")
+            utf8Policy = UTF8_REJECT;
+        else if (value == "repair")
+            utf8Policy = UTF8_REPAIR;
+        else
+            throw std::runtime_error("utf8_policy must be off, reject or repair: " + value);
+    }
+    else if (key == "nick_len")
+        nickLength = static_cast<size_t>(parsePositive(key, value));
+    else if (key == "max_list_entries")
+        maxListEntries = static_cast<size_t>(parsePositive(key, value));
+    else if (key == "dline")
+    {
+        uint32_t network;
+        int bits;
+        if (!parseCidr(value, network, bits))
+            throw std::runtime_error("dline expects <address>[/<bits>]: " + value);
+        dlines.push_back(value);
+    }
+    else if (key == "kline")
+    {
+        if (value.find('@') == std::string::npos || value.find(' ') != std::string::npos)
+            throw std::runtime_error("kline expects <user>@<host>: " + value);
+        klines.push_back(value);
+    }
+    else if (key == "registration_timeout")
+    {
+        registrationTimeout = parseInt(key, value);
+        if (registrationTimeout < 0)
+            throw std::runtime_error("'" + key + "' must not be negative");
+    }
+    else if (key == "max_unregistered")
+        maxUnregistered = static_cast<size_t>(parsePositive(key, value));
+    else if (key == "ping_interval")
+    {
+        pingInterval = parseInt(key, value);
+        if (pingInterval < 0)
+            throw std::runtime_error("'" + key + "' must not be negative");
+    }
+    else if (key == "ping_timeout")
+        pingTimeout = parsePositive(key, value);
+    else if (key == "tick_line_budget")
+        tickLineBudget = parseCount(key, value);
+    else if (key == "recvq")
+        defaultClass.recvQ = parseBytes(key, value);
+    else if (key == "flood_chat")
+        defaultClass.flood[FLOOD_CHAT] = parseFloodLimit(key, value);
+    else if (key == "flood_join")
+        defaultClass.flood[FLOOD_JOIN] = parseFloodLimit(key, value);
+    else if (key == "flood_mode")
+        defaultClass.flood[FLOOD_MODE] = parseFloodLimit(key, value);
+    else if (key == "flood_other")
+        defaultClass.flood[FLOOD_OTHER] = parseFloodLimit(key, value);
+    else if (key == "max_per_ip")
+        defaultClass.maxPerIp = parseCount(key, value);
+    else if (key == "connect_rate")
+        defaultClass.connectRate = parseFloodLimit(key, value);
+    else if (key == "ip_limit_prefix")
+    {
+        ipLimitPrefix = parsePositive(key, value);
+        if (ipLimitPrefix > 32)
+            throw std::runtime_error("ip_limit_prefix must be between 1 and 32");
+    }
+    else if (key == "connection_class")
+        connectionClasses.push_back(parseConnectionClass(value, defaultClass));
+    else if (key == "read_pause_sendq")
+        readPauseSendQ = value == "0" ? 0 : parseBytes(key, value);
+    else if (key == "read_pause_output")
+        readPauseOutput = value == "0" ? 0 : parseBytes(key, value);
+    else
+        throw std::runtime_error("Unknown config key: " + key);
+}
+
+void ServerConfig::loadFile(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Cannot open config file: " + path);
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNo;
+        line = trimWhitespace(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            throw std::runtime_error(path + ":" + std::to_string(lineNo) + ": expected key = value");
+
+        set(trimWhitespace(line.substr(0, eq)), trimWhitespace(line.substr(eq + 1)));
+    }
+}
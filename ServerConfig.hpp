@@ -0,0 +1,155 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Command groups with separate flood budgets.
+enum FloodClass
+{
+    FLOOD_CHAT,   // PRIVMSG, NOTICE
+    FLOOD_JOIN,   // JOIN, PART
+    FLOOD_MODE,   // MODE
+    FLOOD_OTHER,  // everything else
+    FLOOD_CLASS_COUNT
+};
+
+/// Token bucket: up to burst commands back to back, refilled at perSecond.
+/// perSecond 0 means unlimited.
+struct FloodLimit
+{
+    double burst;
+    double perSecond;
+};
+
+/// What happens to a PRIVMSG, NOTICE or TOPIC line that is not valid UTF-8.
+enum Utf8Policy
+{
+    UTF8_OFF,     // not checked
+    UTF8_REJECT,  // dropped; PRIVMSG and TOPIC get FAIL ... INVALID_UTF8
+    UTF8_REPAIR,  // invalid sequences replaced with U+FFFD
+};
+
+/// Limits shared by a group of connections, chosen by source address.
+struct ConnectionClass
+{
+    std::string name;
+    uint32_t network = 0;  // host byte order, already masked
+    uint32_t mask = 0;
+    // Bytes of output that may wait for a slow reader before the
+    // connection is dropped with "Max SendQ exceeded".
+    size_t sendQ = 1048576;
+    // Registered clients' commands over budget wait in the receive buffer;
+    // once it holds more than recvQ bytes the client is dropped with
+    // "Excess Flood".
+    FloodLimit flood[FLOOD_CLASS_COUNT] = {{20, 10}, {10, 2}, {10, 2}, {20, 10}};
+    size_t recvQ = 8192;
+    // Per source address (see ServerConfig::ipLimitPrefix): concurrent
+    // connections (0: unlimited) and connects accepted, as a token bucket.
+    unsigned maxPerIp = 16;
+    FloodLimit connectRate = {8, 1};
+};
+
+/// Parses "<address>[/<bits>]" into a host-order IPv4 network with its host
+/// bits cleared. False if malformed.
+bool parseCidr(const std::string& text, uint32_t& network, int& bits);
+
+/// Optional runtime settings that are not covered by the mandatory
+/// <port> <password> arguments. Every field has a default, so no config file
+/// is needed, but the defaults include connection, flood and keepalive limits
+/// (README.MD lists them, with a config that lifts them).
+struct ServerConfig
+{
+    // Admin endpoint serving Prometheus text metrics.
+    // A Unix socket path takes precedence over a loopback TCP port; both
+    // empty/zero means the endpoint is disabled.
+    std::string adminSocket;
+    int adminPort = 0;
+
+    // POST and DELETE on /dline and /kline. Refused with 403 unless this is
+    // set, and then only over admin_socket: the TCP port is open to every
+    // local user, and to any web page through the browser.
+    bool adminBansWritable = false;
+
+    // Ticks whose processing time exceeds this are logged with the slowest
+    // handler. 0 disables the warning.
+    int slowTickMs = 100;
+
+    // Chrome trace-event output; empty disables tracing. One socket read in
+    // traceSample is traced, and recording stops after traceMaxEvents spans.
+    std::string traceFile;
+    unsigned traceSample = 100;
+    uint64_t traceMaxEvents = 1000000;
+
+    // Binary capture of every connection's inbound traffic (connects, lines,
+    // disconnects) for tools/ircreplay; empty disables it.
+    std::string captureFile;
+
+    // Connections matching no connection_class use defaultClass, whose
+    // limits are set with the "sendq", "recvq" and "flood_*" keys. Classes
+    // are matched in file order ("connection_class = <name>
+    // <address>/<bits> <sendq> [recvq=<bytes>] [ip_max=<n>]
+    // [<group>=<burst>/<rate>]...", where the groups include "connect")
+    // and start from the defaults set above them.
+    ConnectionClass defaultClass = {"default", 0, 0, 1048576};
+    std::vector<ConnectionClass> connectionClasses;
+
+    // Read backpressure: a client stops being read while its own SendQ holds
+    // readPauseSendQ bytes (capped at half its class's sendQ), or after one
+    // read made it submit readPauseOutput bytes of output while output was
+    // backing up. 0 disables either check.
+    size_t readPauseSendQ = 65536;
+    size_t readPauseOutput = 1048576;
+
+    // Per-address limits count connections from the same /ipLimitPrefix
+    // network together.
+    int ipLimitPrefix = 32;
+
+    // Charset enforcement for message bodies (see Utf8Policy).
+    Utf8Policy utf8Policy = UTF8_OFF;
+
+    // NICKLEN: longest nickname accepted at registration and by NICK.
+    size_t nickLength = 30;
+
+    // Longest ban, ban exception and invite exception list per channel;
+    // further +b/+e/+I get ERR_BANLISTFULL.
+    size_t maxListEntries = 100;
+
+    // Server bans in force at startup; the admin endpoint adds and removes
+    // more at run time. D-lines ("dline = <address>[/<bits>]") refuse
+    // connections at accept, K-lines ("kline = <user>@<host>", with '*' and
+    // '?' wildcards) refuse them when registration completes.
+    std::vector<std::string> dlines;
+    std::vector<std::string> klines;
+
+    // Registration: a connection must complete PASS/NICK/USER within
+    // registrationTimeout seconds (0: no deadline), and at most
+    // maxUnregistered connections may be registering at once; further
+    // connections are refused at accept.
+    int registrationTimeout = 30;
+    size_t maxUnregistered = 4096;
+
+    // Keepalive: a connection silent for pingInterval seconds is sent a
+    // PING, and closed with "Ping timeout" if it stays silent for
+    // pingTimeout more. pingInterval 0 disables both.
+    int pingInterval = 120;
+    int pingTimeout = 60;
+
+    // Lines one connection may run per tick; the rest wait for the next
+    // tick so a pasting client cannot starve the others. 0 is unlimited.
+    unsigned tickLineBudget = 10;
+
+    /// The first class whose network contains addr, or defaultClass.
+    const ConnectionClass& classFor(const sockaddr_in& addr) const;
+
+    /// Reads "key = value" lines from a file. Blank lines and lines starting
+    /// with '#' are ignored. Throws std::runtime_error on unknown keys or
+    /// malformed values.
+    void loadFile(const std::string& path);
+
+    /// Applies a single key/value pair (same keys as the file format).
+    void set(const std::string& key, const std::string& value);
+};
@@ -1,61 +1,108 @@
-#include <unordered_set>
-
 #include "Server.hpp"
 #include "modes/ModeHandler.hpp"
 #include "modes/ModeUtils.hpp"
 #include "utils.hpp"
 
-bool Server::applyChannelMode(Client* client, Channel& channel,
-                              const std::string& flag,
-                              const std::vector<std::string>& params) {
-    bool adding = (flag[0] == '+');
-    char modeChar = flag[1];
-
+bool Server::applyChannelMode(Client* client, Channel& channel, bool adding,
+                              char modeChar, const std::string* param,
+                              ModeChanges& changes) {
     switch (modeChar) {
         case 'i':
-            return handleInviteOnlyMode(client, channel, adding);
+            handleInviteOnlyMode(channel, adding, changes);
+            return true;
         case 't':
-            return handleTopicRestrictMode(client, channel, adding);
+            handleTopicRestrictMode(channel, adding, changes);
+            return true;
         case 'k':
-            return handleKeyMode(client, channel, adding, params);
+            handleKeyMode(client, channel, adding, param, changes);
+            return true;
         case 'l':
-            return handleLimitMode(client, channel, adding, params);
+            handleLimitMode(client, channel, adding, param, changes);
+            return true;
         case 'o':
-            return handleOpMode(*this, client, channel, adding, params);
+            handleOpMode(*this, client, channel, adding, param, changes);
+            return true;
+        case 'b':
+        case 'e':
+        case 'I':
+            handleListMode(*this, client, channel, modeChar, adding, param,
+                           changes);
+            return true;
         default:
             return false;
     }
 }
 
+// Whether a mode letter takes the next parameter. -k takes one as RFC 2812
+// has it, but does without; list modes without one are a list query.
+static bool takesParam(char mode, bool adding) {
+    switch (mode) {
+        case 'k':
+        case 'o':
+        case 'b':
+        case 'e':
+        case 'I':
+            return true;
+        case 'l':
+            return adding;
+        default:
+            return false;
+    }
+}
+
+// MODE <channel> [<modes> [<param>...]]: one pass over the mode string,
+// parameters consumed in order. Changes that took effect are announced in
+// a single MODE line.
 void Server::setMode(int clientFd, std::vector<std::string>& params) {
     Client* client = getClientObjByFd(clientFd);
     if (!client)
         return;
 
-    // Query only: MODE #chan
-    if (params.size() == 2) {
-        Channel* chan = findChannel(params[1]);
-        if (chan)
-            returnChannelMode(*this, clientFd, *chan);
+    Channel* channel = findChannel(params[1]);
+    if (!channel) {
+        sendError(clientFd, "403", client->getNick(),
+                  params[1] + " :No such channel");
         return;
     }
 
-    // Validate & check operator rights
-    if (!verifyParams(*this, clientFd, params) ||
-        !hasOpRights(*this, clientFd, params[1])) {
-        sendError(clientFd, "482", client->getNick(),
-                  params[1] + " :You're not channel operator");
+    // Query only: MODE #chan
+    if (params.size() == 2) {
+        returnChannelMode(*this, clientFd, *channel);
         return;
     }
 
-    Channel& channel = _channels.at(getChannelIndex(*this, params[1]));
-    const std::string& flag = params[2];
+    const bool isOp = channel->isInChannel(client) && channel->isOperator(client);
+    const std::string& modes = params[2];
+    size_t nextParam = 3;
+    bool adding = true;
+    ModeChanges changes;
 
-    if (!applyChannelMode(client, channel, flag, params)) {
-        char bad = flag.size() > 1 ? flag[1] : '?';
-        sendError(clientFd, "472", client->getNick(),
-                  std::string(1, bad) + " :is unknown mode char to me");
+    for (char mode : modes) {
+        if (mode == '+' || mode == '-') {
+            adding = mode == '+';
+            continue;
+        }
+        const std::string* param = nullptr;
+        if (takesParam(mode, adding) && nextParam < params.size())
+            param = &params[nextParam++];
+
+        // Listing a ban, exception or invite list needs no privileges.
+        bool listQuery = !param && (mode == 'b' || mode == 'e' || mode == 'I');
+        if (!isOp && !listQuery) {
+            sendError(clientFd, "482", client->getNick(),
+                      channel->getName() + " :You're not channel operator");
+            break;
+        }
+        if (!applyChannelMode(client, *channel, adding, mode, param, changes))
+            sendError(clientFd, "472", client->getNick(),
+                      std::string(1, mode) + " :is unknown mode char to me");
     }
+
+    if (!changes.empty())
+        channel->broadcast(changes.line(client->getNick() + "!~" +
+                                            client->getUser() + "@" +
+                                            client->getIPa(),
+                                        channel->getName()));
 }
 
 void Server::handleMode(int clientFd, const std::string& arg) {
@@ -131,6 +178,6 @@ void Server::handleMode(int clientFd, const std::string& arg) {
         // Respond to the client: confirm mode change
         std::string reply = ":" + client->getNick() + " MODE " + target + " " +
                             params[2] + "\r\n";
-        send(clientFd, reply.c_str(), reply.length(), 0);
+        sendMessage(clientFd, reply);
     }
 }
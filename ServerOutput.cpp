@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <unordered_set>
+
+#include "Server.hpp"
+#include "metrics/Trace.hpp"
+#include "net/SendQueue.hpp"
+
+// POLLOUT on a client: write what its queue holds and stop watching for
+// writability once it is empty.
+void Server::flushSendQueue(size_t index)
+{
+    pollfd& pfd = _poll_fds[index];
+    TraceSample sample(pfd.fd);
+    TraceSpan flushSpan("flush", pfd.fd);
+    if (g_sendQueues.flush(pfd.fd))
+        pfd.events &= ~POLLOUT;
+}
+
+// Adds POLLOUT for connections whose output started queueing this tick.
+void Server::watchBlockedQueues()
+{
+    std::vector<int> blocked = g_sendQueues.takeBlocked();
+    if (blocked.empty())
+        return;
+    std::unordered_set<int> fds(blocked.begin(), blocked.end());
+    for (pollfd& pfd : _poll_fds)
+    {
+        if (fds.count(pfd.fd) && g_sendQueues.pending(pfd.fd))
+            pfd.events |= POLLOUT;
+    }
+}
+
+// Stops reading clientFd when its own SendQ holds read_pause_sendq bytes
+// (at most half its class limit, so the pause comes before the drop), or
+// when, since queuedBefore/submittedBefore were sampled, it has produced
+// read_pause_output bytes and the server's queues grew.
+void Server::pauseIfCongested(int clientFd, uint64_t queuedBefore, uint64_t submittedBefore)
+{
+    // Server-wide queued bytes at or below which reading resumes.
+    uint64_t resumeAt;
+    size_t ownLimit = _config.readPauseSendQ;
+    if (const ConnectionClass* cls = g_sendQueues.connectionClass(clientFd))
+        ownLimit = std::min(ownLimit, cls->sendQ / 2);
+    if (ownLimit && g_sendQueues.pending(clientFd) >= ownLimit)
+        resumeAt = UINT64_MAX;  // its own queue draining is enough
+    else if (_config.readPauseOutput &&
+             g_sendQueues.submittedBytes() - submittedBefore >= _config.readPauseOutput &&
+             g_sendQueues.queuedBytes() > queuedBefore)
+        resumeAt = std::max<uint64_t>(queuedBefore, _config.readPauseOutput);
+    else
+        return;
+
+    for (pollfd& pfd : _poll_fds)
+    {
+        if (pfd.fd == clientFd)
+        {
+            pfd.events &= ~POLLIN;
+            break;
+        }
+    }
+    _readPaused[clientFd] = resumeAt;
+    _metrics.readPauses++;
+    std::cerr << "[WARN] Pausing reads from fd=" << clientFd << ": "
+              << g_sendQueues.pending(clientFd) << " bytes in its SendQ, "
+              << g_sendQueues.queuedBytes() << " queued server-wide" << std::endl;
+}
+
+// A paused client is read again once its own queue is empty and the
+// server-wide backlog is down to the level recorded when it was paused.
+// Complete lines it had already sent are run next tick.
+void Server::resumeReaders()
+{
+    for (std::unordered_map<int, uint64_t>::iterator it = _readPaused.begin();
+         it != _readPaused.end();)
+    {
+        int fd = it->first;
+        if (g_sendQueues.pending(fd) || g_sendQueues.queuedBytes() > it->second)
+        {
+            ++it;
+            continue;
+        }
+        for (pollfd& pfd : _poll_fds)
+        {
+            if (pfd.fd == fd)
+            {
+                pfd.events |= POLLIN;
+                break;
+            }
+        }
+        if (_recvBuffers[fd].find('\n') != std::string::npos)
+            _linesWaiting.emplace(fd, 0);
+        it = _readPaused.erase(it);
+    }
+}
+
+void Server::dropSlowConsumers()
+{
+    // Each QUIT broadcast can push other queues over their limit.
+    for (std::vector<int> fds = g_sendQueues.takeOverflowed(); !fds.empty();
+         fds = g_sendQueues.takeOverflowed())
+    {
+        for (int fd : fds) dropSlowConsumer(fd);
+    }
+}
+
+void Server::dropSlowConsumer(int fd)
+{
+    size_t index = 0;
+    while (index < _poll_fds.size() && _poll_fds[index].fd != fd) ++index;
+    if (index == _poll_fds.size())
+        return;  // closed earlier in the tick
+
+    const ConnectionClass* cls = g_sendQueues.connectionClass(fd);
+    std::string className = cls ? cls->name : _config.defaultClass.name;
+    _metrics.sendQExceeded[className]++;
+    std::cerr << "[WARN] Max SendQ exceeded: fd=" << fd << ", class " << className << ", "
+              << g_sendQueues.pending(fd) << " bytes queued" << std::endl;
+
+    closeLink(fd, index, "Max SendQ exceeded");
+}
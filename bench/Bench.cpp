@@ -0,0 +1,136 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+
+void usage(const char* prog)
+{
+    std::cerr << "Usage: " << prog
+              << " [--json FILE] [--filter SUBSTRING] [--min-time MS] [--KEY VALUE ...]\n";
+    std::exit(2);
+}
+
+std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+}  // namespace
+
+BenchRunner::BenchRunner(const std::string& suite, int argc, char** argv)
+    : _suite(suite), _minTimeNs(250e6)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            usage(argv[0]);
+        if (arg == "--json")
+            _jsonPath = argv[++i];
+        else if (arg == "--filter")
+            _filter = argv[++i];
+        else if (arg == "--min-time")
+            _minTimeNs = std::atof(argv[++i]) * 1e6;
+        else if (arg.compare(0, 2, "--") == 0 && arg.size() > 2)
+            _options[arg.substr(2)] = argv[++i];
+        else
+            usage(argv[0]);
+    }
+}
+
+bool BenchRunner::enabled(const std::string& name) const
+{
+    return _filter.empty() || name.find(_filter) != std::string::npos;
+}
+
+std::string BenchRunner::option(const std::string& key, const std::string& fallback) const
+{
+    std::map<std::string, std::string>::const_iterator it = _options.find(key);
+    return it == _options.end() ? fallback : it->second;
+}
+
+BenchResult& BenchRunner::report(const std::string& name)
+{
+    BenchResult result;
+    result.name = name;
+    result.iterations = 0;
+    result.nsPerOp = 0;
+    result.minNsPerOp = 0;
+    _results.push_back(result);
+    return _results.back();
+}
+
+BenchResult& BenchRunner::record(const std::string& name, uint64_t iterations,
+                                 std::vector<double>& batchNsPerOp)
+{
+    std::sort(batchNsPerOp.begin(), batchNsPerOp.end());
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = batchNsPerOp[batchNsPerOp.size() / 2];
+    result.minNsPerOp = batchNsPerOp.front();
+    _results.push_back(result);
+
+    std::fprintf(stdout, "%-48s %14.1f ns/op %14.1f min %12llu iters\n", name.c_str(),
+                 result.nsPerOp, result.minNsPerOp, (unsigned long long)iterations);
+    std::fflush(stdout);
+    return _results.back();
+}
+
+void BenchRunner::writeJson(std::ostream& out) const
+{
+    out << "{\n  \"suite\": \"" << jsonEscape(_suite) << "\",\n";
+    out << "  \"timestamp\": " << static_cast<long long>(std::time(nullptr)) << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+        const BenchResult& r = _results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << jsonEscape(r.name) << "\"";
+        if (r.iterations)
+        {
+            char numbers[160];
+            std::snprintf(numbers, sizeof(numbers),
+                          ", \"iterations\": %llu, \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f",
+                          (unsigned long long)r.iterations, r.nsPerOp, r.minNsPerOp);
+            out << numbers;
+        }
+        for (const auto& counter : r.counters)
+        {
+            char value[64];
+            std::snprintf(value, sizeof(value), "%.3f", counter.second);
+            out << ", \"" << jsonEscape(counter.first) << "\": " << value;
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int BenchRunner::finish()
+{
+    if (_jsonPath.empty())
+        return 0;
+    std::ofstream file(_jsonPath.c_str());
+    if (!file)
+    {
+        std::cerr << "Cannot write " << _jsonPath << "\n";
+        return 1;
+    }
+    writeJson(file);
+    std::cerr << "[INFO] wrote " << _results.size() << " results to " << _jsonPath << "\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "metrics/Clock.hpp"
+
+/// Small harness shared by the programs in bench/.
+///
+/// BenchRunner::run() calibrates an iteration count until one batch takes
+/// about minTime / kBatches, then times kBatches batches and keeps the median
+/// and the fastest ns per operation. Results print as a table on stdout and,
+/// with --json FILE, as JSON so two runs can be diffed before and after a
+/// hot-path change.
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations;  // timed iterations, all batches together; 0 if untimed
+    double nsPerOp;       // median of the batches
+    double minNsPerOp;
+    std::vector<std::pair<std::string, double> > counters;
+
+    void addCounter(const std::string& key, double value) { counters.emplace_back(key, value); }
+};
+
+class BenchRunner
+{
+public:
+    static const int kBatches = 5;
+
+    BenchRunner(const std::string& suite, int argc, char** argv);
+
+    /// False when --filter excludes name.
+    bool enabled(const std::string& name) const;
+
+    /// Value of a program-specific "--key value" option, or fallback.
+    std::string option(const std::string& key, const std::string& fallback) const;
+
+    /// Times fn(), one operation per call. Returns null if filtered out.
+    template <typename Fn>
+    BenchResult* run(const std::string& name, Fn&& fn);
+
+    /// Like run(), but calls prepare() untimed before every fn() and times
+    /// each fn() on its own. For operations that need state reset or sockets
+    /// drained between calls; only worth it when fn() takes microseconds.
+    template <typename Prepare, typename Fn>
+    BenchResult* runEach(const std::string& name, Prepare&& prepare, Fn&& fn);
+
+    /// Adds an untimed result (a measurement such as a memory figure); the
+    /// caller fills in its counters.
+    BenchResult& report(const std::string& name);
+
+    /// Prints the table and writes the JSON file if one was requested.
+    /// Returns the process exit code.
+    int finish();
+
+private:
+    std::string _suite;
+    std::string _jsonPath;
+    std::string _filter;
+    double _minTimeNs;
+    std::map<std::string, std::string> _options;
+    std::vector<BenchResult> _results;
+
+    BenchResult& record(const std::string& name, uint64_t iterations,
+                        std::vector<double>& batchNsPerOp);
+    void writeJson(std::ostream& out) const;
+};
+
+/// Keeps the compiler from discarding a computed value.
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename Fn>
+BenchResult* BenchRunner::run(const std::string& name, Fn&& fn)
+{
+    if (!enabled(name))
+        return nullptr;
+
+    const double batchTargetNs = _minTimeNs / kBatches;
+    uint64_t perBatch = 1;
+    while (true)
+    {
+        uint64_t start = monotonicNs();
+        for (uint64_t i = 0; i < perBatch; ++i) fn();
+        double elapsed = static_cast<double>(monotonicNs() - start);
+        if (elapsed >= batchTargetNs / 4 || perBatch >= (uint64_t(1) << 40))
+        {
+            if (elapsed < batchTargetNs && elapsed > 0)
+                perBatch = static_cast<uint64_t>(perBatch * batchTargetNs / elapsed) + 1;
+            break;
+        }
+        perBatch *= 8;
+    }
+
+    std::vector<double> batches;
+    for (int b = 0; b < kBatches; ++b)
+    {
+        uint64_t start = monotonicNs();
+        for (uint64_t i = 0; i < perBatch; ++i) fn();
+        batches.push_back(static_cast<double>(monotonicNs() - start) / perBatch);
+    }
+    return &record(name, perBatch * kBatches, batches);
+}
+
+template <typename Prepare, typename Fn>
+BenchResult* BenchRunner::runEach(const std::string& name, Prepare&& prepare, Fn&& fn)
+{
+    if (!enabled(name))
+        return nullptr;
+
+    auto timedBatch = [&](uint64_t calls) {
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < calls; ++i)
+        {
+            prepare();
+            uint64_t start = monotonicNs();
+            fn();
+            total += monotonicNs() - start;
+        }
+        return static_cast<double>(total);
+    };
+
+    const double batchTargetNs = _minTimeNs / kBatches;
+    double first = timedBatch(1);
+    uint64_t perBatch = 1;
+    if (first > 0 && first < batchTargetNs)
+        perBatch = static_cast<uint64_t>(batchTargetNs / first) + 1;
+
+    std::vector<double> batches;
+    for (int b = 0; b < kBatches; ++b) batches.push_back(timedBatch(perBatch) / perBatch);
+    return &record(name, perBatch * kBatches, batches);
+}
@@ -0,0 +1,256 @@
+// Channel fan-out benchmark: one channel of 10 / 100 / 1k / 10k members,
+// every member a registered Client whose fd is one end of a socketpair().
+// Times Channel::broadcast, executePrivmsg, handleJoin and executeQuit end
+// to end, including the real send() syscalls, and reports ns per recipient
+// and send() calls and bytes per message. Peer ends are drained between
+// calls, outside the timed region.
+//
+// Run through `make bench`, which links the same objects as ircserv.
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Channel.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+#include "commands/privmsg.hpp"
+#include "commands/quit.hpp"
+
+namespace
+{
+
+uint64_t g_sendCalls = 0;
+uint64_t g_sendBytes = 0;
+
+}  // namespace
+
+// Counts every send() the server code makes; the objects are linked into
+// this binary, so this definition takes precedence over libc's.
+extern "C" ssize_t send(int fd, const void* buf, size_t len, int flags)
+{
+    typedef ssize_t (*SendFn)(int, const void*, size_t, int);
+    static SendFn realSend = reinterpret_cast<SendFn>(dlsym(RTLD_NEXT, "send"));
+    ++g_sendCalls;
+    ssize_t n = realSend(fd, buf, len, flags);
+    if (n > 0)
+        g_sendBytes += n;
+    return n;
+}
+
+namespace
+{
+
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+const char* const kChannel = "#fanout";
+const std::string kText = "the quick brown fox jumps over the lazy dog, 0123456789";
+
+// Raises RLIMIT_NOFILE to at least want; returns the limit in effect.
+rlim_t ensureFdLimit(rlim_t want)
+{
+    rlimit lim;
+    getrlimit(RLIMIT_NOFILE, &lim);
+    if (lim.rlim_cur >= want)
+        return lim.rlim_cur;
+    rlimit raised = lim;
+    raised.rlim_cur = want;
+    if (raised.rlim_max < want)
+        raised.rlim_max = want;  // needs CAP_SYS_RESOURCE
+    if (setrlimit(RLIMIT_NOFILE, &raised) == 0)
+        return want;
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+    return lim.rlim_cur;
+}
+
+class Fixture
+{
+public:
+    explicit Fixture(size_t members) : _server(0, "password", false)
+    {
+        // _channels is not touched again, so the pointer stays valid.
+        _server.getChannels().push_back(Channel(kChannel));
+        _channel = &_server.getChannels().back();
+        for (size_t i = 0; i < members; ++i)
+        {
+            int fd = addClient("m" + std::to_string(i));
+            _channel->addClient(_server.getClientObjByFd(fd));
+            if (i == 0)
+                _channel->addOp(fd);
+        }
+        _sender = _fds.front();
+        _joiner = addClient("joiner");
+        _quitter = addClient("quitter");
+        _server.eraseClient(_quitter, nullptr);
+    }
+
+    ~Fixture()
+    {
+        for (int fd : _fds) close(fd);
+        for (int fd : _peers) close(fd);
+    }
+
+    Server& server() { return _server; }
+    Channel& channel() { return *_channel; }
+    int sender() const { return _sender; }
+    int joiner() const { return _joiner; }
+    int quitter() const { return _quitter; }
+
+    void drain()
+    {
+        char buf[4096];
+        for (int fd : _peers)
+            while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+            {
+            }
+    }
+
+    // Puts the quitter back into the server and the channel.
+    void restoreQuitter()
+    {
+        Client client(_quitter, "127.0.0.1");
+        client.setNickname("quitter");
+        client.setUsername("bench");
+        client.setAsRegistered();
+        _server.addClient(client);
+        channel().addClient(_server.getClientObjByFd(_quitter));
+    }
+
+    void removeJoiner()
+    {
+        Client* joiner = _server.getClientObjByFd(_joiner);
+        channel().removeClient(joiner);
+        channel().removeOp(_joiner);
+    }
+
+private:
+    Server _server;
+    Channel* _channel;
+    std::vector<int> _fds;
+    std::vector<int> _peers;
+    int _sender;
+    int _joiner;
+    int _quitter;
+
+    int addClient(const std::string& nick)
+    {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+            throw std::runtime_error("socketpair failed");
+        fcntl(sv[1], F_SETFL, O_NONBLOCK);
+        _fds.push_back(sv[0]);
+        _peers.push_back(sv[1]);
+
+        Client client(sv[0], "127.0.0.1");
+        client.setNickname(nick);
+        client.setUsername("bench");
+        client.setAsRegistered();
+        _server.addClient(client);
+        return sv[0];
+    }
+};
+
+// Runs one fan-out operation and attaches per-recipient and per-message
+// counters. recipients is how many members receive each message.
+template <typename Prepare, typename Fn>
+void measure(BenchRunner& bench, const std::string& name, size_t recipients, Prepare&& prepare,
+             Fn&& fn)
+{
+    uint64_t calls = 0;
+    uint64_t sends = 0;
+    uint64_t bytes = 0;
+    BenchResult* result = bench.runEach(name, prepare, [&] {
+        uint64_t startCalls = g_sendCalls;
+        uint64_t startBytes = g_sendBytes;
+        fn();
+        sends += g_sendCalls - startCalls;
+        bytes += g_sendBytes - startBytes;
+        ++calls;
+    });
+    if (!result)
+        return;
+    result->addCounter("recipients", recipients);
+    result->addCounter("ns_per_recipient", result->nsPerOp / recipients);
+    result->addCounter("syscalls_per_msg", static_cast<double>(sends) / calls);
+    result->addCounter("bytes_per_msg", static_cast<double>(bytes) / calls);
+    std::printf("%-48s %14.1f ns/recipient %9.1f send()/msg\n", "", result->nsPerOp / recipients,
+                static_cast<double>(sends) / calls);
+}
+
+void benchFanout(BenchRunner& bench, size_t members)
+{
+    std::string suffix = "/" + std::to_string(members);
+    Fixture fixture(members);
+    Server& server = fixture.server();
+    const std::string privmsg = std::string("PRIVMSG ") + kChannel + " :" + kText;
+    const std::string line = ":m0!~bench@127.0.0.1 PRIVMSG " + std::string(kChannel) + " :" +
+                             kText + "\r\n";
+    auto drain = [&] { fixture.drain(); };
+
+    measure(bench, "broadcast" + suffix, members, drain,
+            [&] { fixture.channel().broadcast(line); });
+
+    measure(bench, "executePrivmsg" + suffix, members - 1, drain,
+            [&] { executePrivmsg(server, fixture.sender(), privmsg); });
+
+    measure(
+        bench, "handleJoin" + suffix, members,
+        [&] {
+            fixture.removeJoiner();
+            fixture.drain();
+        },
+        [&] { server.handleJoin(fixture.joiner(), std::string("JOIN ") + kChannel); });
+    fixture.removeJoiner();
+
+    measure(
+        bench, "executeQuit" + suffix, members,
+        [&] {
+            fixture.restoreQuitter();
+            fixture.drain();
+        },
+        [&] { executeQuit(server, fixture.quitter(), "QUIT :bench"); });
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    BenchRunner bench("fanout", argc, argv);
+
+    NullBuffer null;
+    std::streambuf* realCout = std::cout.rdbuf(&null);
+
+    const size_t sizes[] = {10, 100, 1000, 10000};
+    for (size_t members : sizes)
+    {
+        // Two fds per member, plus joiner, quitter, listener and stdio.
+        rlim_t need = 2 * (members + 2) + 64;
+        rlim_t limit = ensureFdLimit(need);
+        if (limit < need)
+        {
+            std::cerr << "[WARN] skipping " << members << " members: RLIMIT_NOFILE is " << limit
+                      << ", need " << need << "\n";
+            continue;
+        }
+        benchFanout(bench, members);
+    }
+
+    std::cout.rdbuf(realCout);
+    return bench.finish();
+}
@@ -0,0 +1,521 @@
+// Idle-connection memory benchmark.
+//
+// For each client count in the budget file, starts a fresh ircserv with the
+// admin endpoint enabled, then:
+//   1. connects and registers that many idle clients (spread over several
+//      127.0.0.x source addresses so ephemeral ports never run out),
+//   2. joins each to a few channels with a skewed size distribution,
+// and reads the server's RSS from /proc after each phase. The result is RSS
+// per connection (phase 1) and per channel membership (phase 2), plus the
+// ircserv_memory_bytes breakdown from /metrics. Both figures are checked
+// against the budget file; the exit status is 1 when one is exceeded.
+//
+// Run through `make bench-memory`.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+
+namespace
+{
+
+const char* const kPassword = "bench";
+const size_t kClientsPerSourceIp = 20000;
+const size_t kConnectBatch = 500;
+const uint64_t kPhaseTimeoutNs = 300ull * 1000000000ull;
+
+struct Budget
+{
+    std::vector<size_t> clients;
+    size_t channelsPerClient = 3;
+    size_t clientsPerChannel = 50;
+    double rssPerConnection = 0;
+    double rssPerMembership = 0;
+};
+
+std::string trim(const std::string& s)
+{
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos)
+        return "";
+    return s.substr(start, s.find_last_not_of(" \t\r\n") - start + 1);
+}
+
+Budget loadBudget(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+        throw std::runtime_error("Cannot open budget file: " + path);
+    Budget budget;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            throw std::runtime_error("Invalid budget line: " + line);
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        if (key == "clients")
+        {
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ','))
+                budget.clients.push_back(std::strtoul(item.c_str(), nullptr, 10));
+        }
+        else if (key == "channels_per_client")
+            budget.channelsPerClient = std::strtoul(value.c_str(), nullptr, 10);
+        else if (key == "clients_per_channel")
+            budget.clientsPerChannel = std::strtoul(value.c_str(), nullptr, 10);
+        else if (key == "rss_per_connection")
+            budget.rssPerConnection = std::atof(value.c_str());
+        else if (key == "rss_per_membership")
+            budget.rssPerMembership = std::atof(value.c_str());
+        else
+            throw std::runtime_error("Unknown budget key: " + key);
+    }
+    return budget;
+}
+
+rlim_t raiseFdLimit()
+{
+    rlimit lim;
+    getrlimit(RLIMIT_NOFILE, &lim);
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+    return lim.rlim_cur;
+}
+
+long rssBytes(pid_t pid)
+{
+    std::ifstream status(("/proc/" + std::to_string(pid) + "/status").c_str());
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return std::atol(line.c_str() + 6) * 1024;
+    return -1;
+}
+
+// Minimal blocking HTTP GET of /metrics on 127.0.0.1:port.
+std::string fetchMetrics(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string body;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+    {
+        const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+        if (write(fd, request, sizeof(request) - 1) > 0)
+        {
+            char buf[8192];
+            ssize_t n;
+            while ((n = read(fd, buf, sizeof(buf))) > 0) body.append(buf, n);
+        }
+    }
+    close(fd);
+    size_t start = body.find("\r\n\r\n");
+    return start == std::string::npos ? "" : body.substr(start + 4);
+}
+
+// Sample values by "name" or "name{labels}".
+std::map<std::string, double> parseMetrics(const std::string& text)
+{
+    std::map<std::string, double> values;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t space = line.rfind(' ');
+        if (space != std::string::npos)
+            values[line.substr(0, space)] = std::atof(line.c_str() + space + 1);
+    }
+    return values;
+}
+
+class ServerProcess
+{
+public:
+    ServerProcess(const std::string& binary, int port, int adminPort) : _pid(-1)
+    {
+        _config = "/tmp/ircserv_bench_memory_" + std::to_string(getpid()) + ".conf";
+        // Thousands of clients share each loopback source address.
+        std::ofstream(_config.c_str()) << "admin_port = " << adminPort
+                                       << "\nmax_per_ip = 0\nconnect_rate = 0\n";
+
+        _pid = fork();
+        if (_pid < 0)
+            throw std::runtime_error("fork failed");
+        if (_pid == 0)
+        {
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+            std::string portArg = std::to_string(port);
+            execl(binary.c_str(), binary.c_str(), portArg.c_str(), kPassword, "-config",
+                  _config.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        for (int attempt = 0; attempt < 100; ++attempt)
+        {
+            if (!fetchMetrics(adminPort).empty())
+                return;
+            usleep(50000);
+        }
+        stop();
+        throw std::runtime_error("ircserv did not come up: " + binary);
+    }
+
+    ~ServerProcess()
+    {
+        stop();
+        unlink(_config.c_str());
+    }
+
+    pid_t pid() const { return _pid; }
+
+    void stop()
+    {
+        if (_pid <= 0)
+            return;
+        kill(_pid, SIGTERM);
+        waitpid(_pid, nullptr, 0);
+        _pid = -1;
+    }
+
+private:
+    pid_t _pid;
+    std::string _config;
+};
+
+struct Conn
+{
+    int fd = -1;
+    bool sent = false;
+    bool registered = false;
+    size_t joined = 0;
+    std::string in;
+};
+
+class IdleClients
+{
+public:
+    explicit IdleClients(int port) : _port(port), _registered(0), _joined(0) {}
+
+    ~IdleClients()
+    {
+        for (Conn& c : _conns)
+            if (c.fd >= 0)
+                close(c.fd);
+    }
+
+    // Phase 1: connect and register count clients. Returns false on timeout.
+    bool connectAll(size_t count)
+    {
+        _conns.resize(count);
+        uint64_t deadline = monotonicNs() + kPhaseTimeoutNs;
+        size_t opened = 0;
+        while (_registered < count && monotonicNs() < deadline)
+        {
+            // Keep at most one batch of connections in registration.
+            while (opened < count && opened < _registered + kConnectBatch)
+                open(opened++);
+            pump(50);
+        }
+        return _registered == count;
+    }
+
+    // Phase 2: joins every client to channelsPerClient distinct channels out
+    // of channelCount, skewed so that a few channels are large. Returns the
+    // number of memberships, or 0 on timeout.
+    size_t joinAll(size_t channelCount, size_t channelsPerClient, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        size_t expected = 0;
+        for (Conn& c : _conns)
+        {
+            std::vector<size_t> picked;
+            while (picked.size() < channelsPerClient && picked.size() < channelCount)
+            {
+                double u = uniform(rng);
+                size_t index = static_cast<size_t>(channelCount * u * u);
+                bool duplicate = false;
+                for (size_t p : picked) duplicate = duplicate || p == index;
+                if (!duplicate)
+                    picked.push_back(index);
+            }
+            std::string lines;
+            for (size_t index : picked) lines += "JOIN #idle" + std::to_string(index) + "\r\n";
+            sendAll(c, lines);
+            expected += picked.size();
+        }
+
+        uint64_t deadline = monotonicNs() + kPhaseTimeoutNs;
+        while (_joined < expected && monotonicNs() < deadline) pump(50);
+        return _joined == expected ? expected : 0;
+    }
+
+    // Reads whatever arrives for a while so the server has nothing queued.
+    void settle(int ms)
+    {
+        uint64_t end = monotonicNs() + static_cast<uint64_t>(ms) * 1000000ull;
+        while (monotonicNs() < end) pump(10);
+    }
+
+private:
+    int _port;
+    std::vector<Conn> _conns;
+    std::vector<pollfd> _pfds;
+    std::vector<size_t> _owner;
+    size_t _registered;
+    size_t _joined;
+
+    void open(size_t i)
+    {
+        Conn& c = _conns[i];
+        c.fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (c.fd < 0)
+            throw std::runtime_error("socket failed, fd limit?");
+        fcntl(c.fd, F_SETFL, O_NONBLOCK);
+
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK + i / kClientsPerSourceIp);
+        bind(c.fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(c.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 &&
+            errno != EINPROGRESS)
+            throw std::runtime_error("connect failed");
+    }
+
+    void sendAll(Conn& c, const std::string& data)
+    {
+        size_t off = 0;
+        while (off < data.size())
+        {
+            ssize_t n = send(c.fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n > 0)
+                off += n;
+            else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                return;
+            else
+            {
+                pollfd p = {c.fd, POLLOUT, 0};
+                poll(&p, 1, 10);
+            }
+        }
+    }
+
+    void handleLine(Conn& c, const std::string& line)
+    {
+        size_t sp = line.find(' ');
+        if (line.empty() || line[0] != ':' || sp == std::string::npos)
+            return;
+        if (line.compare(sp + 1, 4, "001 ") == 0 && !c.registered)
+        {
+            c.registered = true;
+            ++_registered;
+        }
+        else if (line.compare(sp + 1, 4, "366 ") == 0)
+        {
+            ++c.joined;
+            ++_joined;
+        }
+    }
+
+    void pump(int timeoutMs)
+    {
+        _pfds.clear();
+        _owner.clear();
+        for (size_t i = 0; i < _conns.size(); ++i)
+        {
+            if (_conns[i].fd < 0)
+                continue;
+            pollfd p = {};
+            p.fd = _conns[i].fd;
+            p.events = POLLIN | (_conns[i].sent ? 0 : POLLOUT);
+            _pfds.push_back(p);
+            _owner.push_back(i);
+        }
+        if (poll(_pfds.data(), _pfds.size(), timeoutMs) <= 0)
+            return;
+
+        char buf[8192];
+        for (size_t k = 0; k < _pfds.size(); ++k)
+        {
+            Conn& c = _conns[_owner[k]];
+            if ((_pfds[k].revents & POLLOUT) && !c.sent)
+            {
+                std::string nick = "idle" + std::to_string(_owner[k]);
+                std::string lines = std::string("PASS ") + kPassword + "\r\nNICK " + nick +
+                                    "\r\nUSER " + nick + " 0 * :idle client\r\n";
+                c.sent = true;
+                sendAll(c, lines);
+            }
+            if (!(_pfds[k].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            ssize_t n;
+            while ((n = recv(c.fd, buf, sizeof(buf), 0)) > 0)
+            {
+                c.in.append(buf, n);
+                size_t start = 0;
+                size_t nl;
+                while ((nl = c.in.find('\n', start)) != std::string::npos)
+                {
+                    handleLine(c, c.in.substr(start, nl - start));
+                    start = nl + 1;
+                }
+                c.in.erase(0, start);
+            }
+        }
+    }
+};
+
+bool runSize(BenchRunner& bench, const Budget& budget, const std::string& binary, size_t clients,
+             int port, int adminPort)
+{
+    std::string name = "idle/" + std::to_string(clients);
+    ServerProcess server(binary, port, adminPort);
+    long baseline = rssBytes(server.pid());
+
+    IdleClients idle(port);
+    if (!idle.connectAll(clients))
+    {
+        std::cerr << "[ERROR] " << name << ": registration timed out\n";
+        return false;
+    }
+    idle.settle(500);
+    long registered = rssBytes(server.pid());
+
+    size_t channelCount = clients / budget.clientsPerChannel;
+    if (channelCount == 0)
+        channelCount = 1;
+    size_t memberships = idle.joinAll(channelCount, budget.channelsPerClient, 42);
+    if (!memberships)
+    {
+        std::cerr << "[ERROR] " << name << ": joins timed out\n";
+        return false;
+    }
+    idle.settle(500);
+    long joined = rssBytes(server.pid());
+    std::map<std::string, double> metrics = parseMetrics(fetchMetrics(adminPort));
+
+    double perConnection = double(registered - baseline) / clients;
+    double perMembership = double(joined - registered) / memberships;
+
+    BenchResult& result = bench.report(name);
+    result.addCounter("clients", clients);
+    result.addCounter("channels", channelCount);
+    result.addCounter("memberships", memberships);
+    result.addCounter("rss_baseline_bytes", baseline);
+    result.addCounter("rss_bytes", joined);
+    result.addCounter("rss_per_connection", perConnection);
+    result.addCounter("rss_per_membership", perMembership);
+
+    std::printf("%-16s rss %.1f MiB (baseline %.1f MiB), %zu memberships in %zu channels\n",
+                name.c_str(), joined / 1048576.0, baseline / 1048576.0, memberships,
+                channelCount);
+    std::printf("%-16s %10.0f B/connection (budget %.0f), %8.0f B/membership (budget %.0f)\n",
+                "", perConnection, budget.rssPerConnection, perMembership,
+                budget.rssPerMembership);
+
+    const char* const structures[] = {"client_objects",  "client_strings",  "client_index",
+                                      "recv_buffers",    "send_queues",     "flood_buckets",
+                                      "timer_wheel",     "poll_fds",        "channel_objects",
+                                      "channel_vectors", "invite_maps"};
+    for (const char* structure : structures)
+    {
+        double bytes =
+            metrics["ircserv_memory_bytes{structure=\"" + std::string(structure) + "\"}"];
+        result.addCounter(std::string(structure) + "_bytes", bytes);
+        std::printf("%-16s %-16s %12.0f B %10.1f B/connection\n", "", structure, bytes,
+                    bytes / clients);
+    }
+
+    bool ok = true;
+    if (budget.rssPerConnection > 0 && perConnection > budget.rssPerConnection)
+    {
+        std::printf("[FAIL] %s: %.0f B per connection exceeds the budget of %.0f\n",
+                    name.c_str(), perConnection, budget.rssPerConnection);
+        ok = false;
+    }
+    if (budget.rssPerMembership > 0 && perMembership > budget.rssPerMembership)
+    {
+        std::printf("[FAIL] %s: %.0f B per membership exceeds the budget of %.0f\n",
+                    name.c_str(), perMembership, budget.rssPerMembership);
+        ok = false;
+    }
+    result.addCounter("within_budget", ok ? 1 : 0);
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    BenchRunner bench("memory", argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+
+    try
+    {
+        Budget budget = loadBudget(bench.option("budget", "bench/memory_budget.conf"));
+        std::string binary = bench.option("server", "./ircserv");
+        int port = std::atoi(bench.option("port", "16667").c_str());
+        int adminPort = std::atoi(bench.option("admin-port", "16668").c_str());
+
+        // The server inherits this limit; each side needs one fd per client.
+        rlim_t limit = raiseFdLimit();
+        bool ok = true;
+        for (size_t clients : budget.clients)
+        {
+            if (!bench.enabled("idle/" + std::to_string(clients)))
+                continue;
+            if (clients + 64 > limit)
+            {
+                std::cerr << "[WARN] skipping " << clients << " clients: RLIMIT_NOFILE is "
+                          << limit << "\n";
+                continue;
+            }
+            ok = runSize(bench, budget, binary, clients, port, adminPort) && ok;
+        }
+        int status = bench.finish();
+        return ok ? status : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "[ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+}
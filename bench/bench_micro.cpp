@@ -0,0 +1,327 @@
+// Microbenchmarks for the per-line hot paths: tokenizing, case folding,
+// trimming, nick validation, channel/nick lookups, NAMES replies, channel
+// ban checks and D-line lookups.
+//
+// Run through `make bench`, which links the same objects as ircserv.
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <regex>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Channel.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+#include "nameRules.hpp"
+#include "net/CidrTree.hpp"
+#include "utf8.hpp"
+#include "utils.hpp"
+
+namespace
+{
+
+// findChannel and Channel::broadcast log every step to std::cout; the
+// benchmarks measure that cost but should not print it.
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+const char* const kLines[] = {
+    "PRIVMSG #general :hello everyone, how is it going today?",
+    "JOIN #alpha,#beta,#gamma key1,key2",
+    "MODE #general +kl secret 50",
+    "NICK some_longer_nickname",
+};
+const size_t kLineCount = sizeof(kLines) / sizeof(kLines[0]);
+
+const size_t kLookupKeys = 64;
+
+std::string channelName(size_t i) { return "#Chan{" + std::to_string(i) + "}"; }
+std::string nickName(size_t i) { return "User|" + std::to_string(i); }
+
+// Keys spread over the whole table, in the other case form, so the lookup
+// has to fold both sides like a real client typing a name differently.
+std::vector<std::string> lookupKeys(size_t size, std::string (*name)(size_t))
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < kLookupKeys; ++i)
+    {
+        std::string key = name((i * 7919 + 13) % size);
+        for (char& c : key)
+        {
+            if (c == '{')
+                c = '[';
+            else if (c == '}')
+                c = ']';
+            else if (c == '|')
+                c = '\\';
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+void benchStrings(BenchRunner& bench)
+{
+    size_t n = 0;
+    bench.run("parser/space", [&] {
+        std::vector<std::string> tokens;
+        parser(kLines[n++ % kLineCount], tokens, ' ');
+        doNotOptimize(tokens.size());
+    });
+    bench.run("parser/comma", [&] {
+        std::vector<std::string> tokens;
+        parser("#alpha,#beta,#gamma,#delta,#epsilon", tokens, ',');
+        doNotOptimize(tokens.size());
+    });
+
+    const std::string upper = "privmsg";
+    bench.run("toUpperCase/command", [&] { doNotOptimize(toUpperCase(upper)); });
+
+    const std::string nick = "Some{Nick}|Here";
+    bench.run("ircCaseFold/nick", [&] { doNotOptimize(ircCaseFold(nick)); });
+    const std::string longText(400, 'A');
+    bench.run("ircCaseFold/400B", [&] { doNotOptimize(ircCaseFold(longText)); });
+
+    const std::string padded = "  \t#general \r\n";
+    bench.run("trimWhitespace/padded", [&] { doNotOptimize(trimWhitespace(padded)); });
+    const std::string clean = "#general";
+    bench.run("trimWhitespace/clean", [&] { doNotOptimize(trimWhitespace(clean)); });
+
+    // The std::regex check that checkNick replaced, kept as the baseline.
+    // It only ever matched one-character strings.
+    static const std::regex incorrectRegex("[^a-zA-Z0-9_\\[\\]{}^`|\\-]");
+    const std::string goodNick = "good_nick";
+    const std::string badNick = "bad*nick";
+    bench.run("regex_match/incorrectRegex/valid", [&] {
+        doNotOptimize(std::regex_match(goodNick, incorrectRegex));
+    });
+    bench.run("regex_match/incorrectRegex/invalid", [&] {
+        doNotOptimize(std::regex_match(badNick, incorrectRegex));
+    });
+    bench.run("checkNick/valid", [&] { doNotOptimize(checkNick(goodNick, 30)); });
+    bench.run("checkNick/invalid", [&] { doNotOptimize(checkNick(badNick, 30)); });
+    const std::string longNick = "Some{Long}Nick|With-Digits42";
+    bench.run("checkNick/28B", [&] { doNotOptimize(checkNick(longNick, 30)); });
+}
+
+// Message bodies of `bytes` bytes: pure ASCII, and chat-like text mixing
+// ASCII with 2-, 3- and 4-byte sequences. Each run reports GB/s next to a
+// memcpy of the same size.
+void benchUtf8(BenchRunner& bench)
+{
+    const char* const words[] = {"hello ", "w\xC3\xB6rld ", "\xE2\x82\xAC" "42 ", "caf\xC3\xA9 ",
+                                 "\xF0\x9F\x98\x80 ", "\xD0\xBF\xD1\x80\xD0\xB8 ",
+                                 "\xE6\x97\xA5\xE6\x9C\xAC ", "ok "};
+    const size_t sizes[] = {256, 4096};
+    for (size_t bytes : sizes)
+    {
+        std::string ascii;
+        while (ascii.size() < bytes) ascii += "the quick brown fox ";
+        ascii.resize(bytes);
+        std::string mixed;
+        for (size_t i = 0; mixed.size() + std::strlen(words[(i * 5) % 8]) <= bytes; ++i)
+            mixed += words[(i * 5) % 8];
+        mixed.resize(bytes, ' ');
+        std::vector<char> copy(bytes);
+
+        std::string suffix = "/" + std::to_string(bytes);
+        auto rate = [&](BenchResult* result) {
+            if (result)
+                result->addCounter("gb_per_s", bytes / result->nsPerOp);
+        };
+        rate(bench.run("memcpy" + suffix, [&] {
+            std::memcpy(copy.data(), ascii.data(), bytes);
+            doNotOptimize(copy[0]);
+        }));
+        rate(bench.run("isValidUtf8/ascii" + suffix,
+                       [&] { doNotOptimize(isValidUtf8(ascii.data(), ascii.size())); }));
+        rate(bench.run("isValidUtf8/mixed" + suffix,
+                       [&] { doNotOptimize(isValidUtf8(mixed.data(), mixed.size())); }));
+        rate(bench.run("isValidUtf8Scalar/ascii" + suffix,
+                       [&] { doNotOptimize(isValidUtf8Scalar(ascii.data(), ascii.size())); }));
+        rate(bench.run("isValidUtf8Scalar/mixed" + suffix,
+                       [&] { doNotOptimize(isValidUtf8Scalar(mixed.data(), mixed.size())); }));
+    }
+}
+
+void benchServerParser(BenchRunner& bench, Server& server)
+{
+    size_t n = 0;
+    bench.run("Server::parser/space", [&] {
+        std::vector<std::string> tokens;
+        server.parser(kLines[n++ % kLineCount], tokens, ' ');
+        doNotOptimize(tokens.size());
+    });
+}
+
+// Grows the server's tables to each size in turn and times lookups at each.
+void benchLookups(BenchRunner& bench, Server& server)
+{
+    const size_t sizes[] = {1000, 10000, 100000};
+    const char* const names[] = {"findChannel/hit", "findChannel/miss", "getClientObjByNick/hit",
+                                 "getClientObjByNick/miss"};
+    std::vector<Channel>& channels = server.getChannels();
+    size_t clients = 0;
+
+    for (size_t size : sizes)
+    {
+        std::string suffix = "/" + std::to_string(size);
+        // Filling the tables is the slow part: skip it unless one of the
+        // lookups below will run.
+        bool wanted = false;
+        for (const char* name : names) wanted = wanted || bench.enabled(name + suffix);
+        if (!wanted)
+            continue;
+
+        channels.reserve(size);
+        while (channels.size() < size) channels.push_back(Channel(channelName(channels.size())));
+        for (; clients < size; ++clients)
+        {
+            Client client(static_cast<int>(100000 + clients), "127.0.0.1");
+            client.setNickname(nickName(clients));
+            server.addClient(client);
+        }
+
+        std::vector<std::string> channelKeys = lookupKeys(size, channelName);
+        size_t n = 0;
+        bench.run("findChannel/hit" + suffix,
+                  [&] { doNotOptimize(server.findChannel(channelKeys[n++ % kLookupKeys])); });
+        bench.run("findChannel/miss" + suffix,
+                  [&] { doNotOptimize(server.findChannel("#no-such-channel")); });
+
+        std::vector<std::string> nickKeys = lookupKeys(size, nickName);
+        bench.run("getClientObjByNick/hit" + suffix,
+                  [&] { doNotOptimize(server.getClientObjByNick(nickKeys[n++ % kLookupKeys])); });
+        bench.run("getClientObjByNick/miss" + suffix,
+                  [&] { doNotOptimize(server.getClientObjByNick("nobody")); });
+    }
+}
+
+void benchNames(BenchRunner& bench)
+{
+    const size_t sizes[] = {10, 100, 1000};
+    for (size_t size : sizes)
+    {
+        std::deque<Client> members;
+        Channel channel("#names");
+        for (size_t i = 0; i < size; ++i)
+        {
+            members.push_back(Client(static_cast<int>(10 + i), "127.0.0.1"));
+            members.back().setNickname(nickName(i));
+            channel.addClient(&members.back());
+            if (i % 10 == 0)
+                channel.addOp(members.back().getFd());
+        }
+        bench.run("namesReply/" + std::to_string(size),
+                  [&] { doNotOptimize(channel.namesReply("joiner")); });
+    }
+}
+
+// A joiner checked against ban lists of each size, next to the linear scan
+// the compiled MaskList replaces. The lists mix host prefixes, domain
+// suffixes and nick bans; the joiner matches none of them, which is the
+// common case and the one where a scan visits every mask.
+void benchBans(BenchRunner& bench)
+{
+    const size_t sizes[] = {10, 1000, 10000};
+    for (size_t size : sizes)
+    {
+        Channel channel("#bans");
+        MaskList& bans = channel.maskList('b');
+        for (size_t i = 0; i < size; ++i)
+        {
+            std::string mask;
+            if (i % 3 == 0)
+                mask = "*!*@10." + std::to_string(i / 250 % 256) + "." + std::to_string(i % 250) +
+                       ".*";
+            else if (i % 3 == 1)
+                mask = "*!*@*.isp" + std::to_string(i) + ".example.net";
+            else
+                mask = nickName(i) + "!*@*";
+            bans.add(mask, "op!~op@127.0.0.1", 0);
+        }
+        Client joiner(10, "192.0.2.55");
+        joiner.setNickname("joiner");
+
+        std::string suffix = "/" + std::to_string(size);
+        bench.run("Channel::isBanned" + suffix, [&] { doNotOptimize(channel.isBanned(&joiner)); });
+        bench.run("linearBanScan" + suffix, [&] {
+            const std::string subject = ircCaseFold(joiner.getNick()) + "!~" +
+                                        ircCaseFold(joiner.getUser()) + "@" + joiner.getIPa();
+            bool banned = false;
+            for (const MaskList::Entry& entry : bans.entries())
+                banned |= wildcardMatch(entry.mask, subject);
+            doNotOptimize(banned);
+        });
+    }
+}
+
+// D-line lookups at accept against 10/1k/10k prefixes of /16 to /32, next
+// to a scan of the same prefixes. The probed addresses are outside every
+// prefix, as for nearly every connection.
+void benchDlines(BenchRunner& bench)
+{
+    const size_t sizes[] = {10, 1000, 10000};
+    for (size_t size : sizes)
+    {
+        CidrTree tree;
+        std::vector<std::pair<uint32_t, uint32_t>> scan;  // network, mask
+        uint32_t seed = 12345;
+        while (tree.size() < size)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int bits = 16 + static_cast<int>(seed >> 28);
+            uint32_t mask = 0xffffffffu << (32 - bits);
+            uint32_t network = ((seed << 4) | 0x80000000u) & mask;  // 128.0.0.0/1
+            if (tree.insert(network, bits))
+                scan.push_back(std::make_pair(network, mask));
+        }
+
+        std::vector<uint32_t> probes;
+        for (uint32_t i = 0; i < 1024; ++i)
+            probes.push_back(0x0a000000u + i * 2654435761u % 0x01000000u);  // 10.0.0.0/8
+        std::string suffix = "/" + std::to_string(size);
+        size_t n = 0;
+        bench.run("CidrTree::contains" + suffix,
+                  [&] { doNotOptimize(tree.contains(probes[n++ % probes.size()])); });
+        bench.run("linearCidrScan" + suffix, [&] {
+            uint32_t addr = probes[n++ % probes.size()];
+            bool banned = false;
+            for (const std::pair<uint32_t, uint32_t>& prefix : scan)
+                banned |= (addr & prefix.second) == prefix.first;
+            doNotOptimize(banned);
+        });
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    BenchRunner bench("micro", argc, argv);
+
+    NullBuffer null;
+    std::streambuf* realCout = std::cout.rdbuf(&null);
+
+    // Port 0: the listener binds an ephemeral port and is never polled.
+    Server server(0, "password", false);
+
+    benchStrings(bench);
+    benchUtf8(bench);
+    benchServerParser(bench, server);
+    benchLookups(bench, server);
+    benchNames(bench);
+    benchBans(bench);
+    benchDlines(bench);
+
+    std::cout.rdbuf(realCout);
+    return bench.finish();
+}
@@ -0,0 +1,88 @@
+#include "CaptureFormat.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+void appendVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+CaptureReader::CaptureReader() : _file(nullptr), _timeNs(0) {}
+
+CaptureReader::~CaptureReader()
+{
+    if (_file)
+        fclose(_file);
+}
+
+void CaptureReader::open(const std::string& path)
+{
+    _file = fopen(path.c_str(), "rb");
+    if (!_file)
+        throw std::runtime_error("Cannot open capture file: " + path);
+    char magic[kCaptureMagicSize];
+    if (fread(magic, 1, sizeof(magic), _file) != sizeof(magic) ||
+        std::memcmp(magic, kCaptureMagic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not a capture file: " + path);
+    _timeNs = 0;
+}
+
+bool CaptureReader::readVarint(uint64_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(_file);
+        if (c == EOF)
+            return false;
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool CaptureReader::next(CaptureRecord& record)
+{
+    int type = fgetc(_file);
+    if (type == EOF)
+        return false;
+
+    uint64_t delta;
+    if (!readVarint(delta) || !readVarint(record.connection))
+        throw std::runtime_error("Truncated capture record");
+    _timeNs += delta;
+    record.timeNs = _timeNs;
+    record.type = static_cast<CaptureRecordType>(type);
+    record.line.clear();
+
+    switch (type)
+    {
+        case CAPTURE_CONNECT:
+            if (fread(&record.address, 1, sizeof(record.address), _file) !=
+                sizeof(record.address))
+                throw std::runtime_error("Truncated capture record");
+            break;
+        case CAPTURE_LINE:
+        {
+            uint64_t length;
+            if (!readVarint(length))
+                throw std::runtime_error("Truncated capture record");
+            record.line.resize(length);
+            if (length && fread(&record.line[0], 1, length, _file) != length)
+                throw std::runtime_error("Truncated capture record");
+            break;
+        }
+        case CAPTURE_DISCONNECT:
+            break;
+        default:
+            throw std::runtime_error("Unknown capture record type " + std::to_string(type));
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/// Binary capture of inbound client traffic (config key capture_file),
+/// replayed by tools/ircreplay.
+///
+/// The file starts with the 8-byte magic "IRCCAP1\n", followed by records:
+///
+///   u8      type           CAPTURE_CONNECT, CAPTURE_LINE or CAPTURE_DISCONNECT
+///   varint  delta_ns       time since the previous record (first: since open)
+///   varint  connection     id assigned at connect, never reused
+///   connect:    4 bytes    IPv4 address, network order
+///   line:       varint length, then the line without CR/LF
+///
+/// Varints are LEB128: 7 bits per byte, least significant group first.
+enum CaptureRecordType
+{
+    CAPTURE_CONNECT = 1,
+    CAPTURE_LINE = 2,
+    CAPTURE_DISCONNECT = 3
+};
+
+const char kCaptureMagic[] = "IRCCAP1\n";
+const size_t kCaptureMagicSize = sizeof(kCaptureMagic) - 1;
+
+struct CaptureRecord
+{
+    CaptureRecordType type;
+    uint64_t timeNs;  // since the capture was opened
+    uint64_t connection;
+    uint32_t address;  // connect only, network order
+    std::string line;  // line only
+};
+
+void appendVarint(std::string& out, uint64_t value);
+
+/// Sequential reader; throws std::runtime_error on a bad magic or a
+/// truncated record.
+class CaptureReader
+{
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    void open(const std::string& path);
+    /// Reads the next record; false at end of file.
+    bool next(CaptureRecord& record);
+
+private:
+    FILE* _file;
+    uint64_t _timeNs;
+
+    bool readVarint(uint64_t& value);
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+};
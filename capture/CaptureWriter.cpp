@@ -0,0 +1,103 @@
+#include "CaptureWriter.hpp"
+
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "net/IoLayer.hpp"
+
+namespace
+{
+const size_t kFlushBytes = 64 * 1024;
+}
+
+CaptureWriter::CaptureWriter() : _file(nullptr), _lastNs(0), _nextConnection(1) {}
+
+CaptureWriter::~CaptureWriter() { close(); }
+
+void CaptureWriter::open(const std::string& path)
+{
+    // Owner-only: the lines include private messages.
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd >= 0)
+    {
+        _file = fdopen(fd, "wb");
+        if (!_file)
+            ::close(fd);
+    }
+    if (!_file)
+        throw std::runtime_error("Cannot open capture file: " + path);
+    _buffer.assign(kCaptureMagic, kCaptureMagicSize);
+    _lastNs = io().nowNs();
+}
+
+void CaptureWriter::close()
+{
+    if (!_file)
+        return;
+    flush();
+    fclose(_file);
+    _file = nullptr;
+}
+
+void CaptureWriter::beginRecord(CaptureRecordType type, uint64_t connection)
+{
+    uint64_t now = io().nowNs();
+    _buffer += static_cast<char>(type);
+    appendVarint(_buffer, now - _lastNs);
+    appendVarint(_buffer, connection);
+    _lastNs = now;
+}
+
+void CaptureWriter::connect(int fd, const sockaddr_in& addr)
+{
+    if (!_file)
+        return;
+    uint64_t connection = _nextConnection++;
+    _connections[fd] = connection;
+    beginRecord(CAPTURE_CONNECT, connection);
+    _buffer.append(reinterpret_cast<const char*>(&addr.sin_addr.s_addr), 4);
+}
+
+void CaptureWriter::line(int fd, const std::string& line)
+{
+    if (!_file)
+        return;
+    std::unordered_map<int, uint64_t>::const_iterator it = _connections.find(fd);
+    if (it == _connections.end())
+        return;
+    beginRecord(CAPTURE_LINE, it->second);
+    // The password is never recorded; ircreplay -w supplies one.
+    if (line.size() > 5 && strncasecmp(line.c_str(), "PASS ", 5) == 0)
+    {
+        appendVarint(_buffer, 6);
+        _buffer += "PASS *";
+    }
+    else
+    {
+        appendVarint(_buffer, line.size());
+        _buffer += line;
+    }
+    if (_buffer.size() >= kFlushBytes)
+        flush();
+}
+
+void CaptureWriter::disconnect(int fd)
+{
+    if (!_file)
+        return;
+    std::unordered_map<int, uint64_t>::iterator it = _connections.find(fd);
+    if (it == _connections.end())
+        return;
+    beginRecord(CAPTURE_DISCONNECT, it->second);
+    _connections.erase(it);
+}
+
+void CaptureWriter::flush()
+{
+    if (!_buffer.empty())
+        fwrite(_buffer.data(), 1, _buffer.size(), _file);
+    _buffer.clear();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+#include "CaptureFormat.hpp"
+
+/// Records connects, inbound lines and disconnects in the format described
+/// in CaptureFormat.hpp. Records are buffered and written in 64 KiB chunks;
+/// close() writes the rest. Every call is a single branch while inactive.
+class CaptureWriter
+{
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    /// Starts writing to path. Throws std::runtime_error if it cannot be opened.
+    void open(const std::string& path);
+    void close();
+    bool active() const { return _file != nullptr; }
+
+    void connect(int fd, const sockaddr_in& addr);
+    void line(int fd, const std::string& line);
+    void disconnect(int fd);
+
+private:
+    FILE* _file;
+    std::string _buffer;
+    uint64_t _lastNs;
+    uint64_t _nextConnection;
+    std::unordered_map<int, uint64_t> _connections;  // fd -> connection id
+
+    void beginRecord(CaptureRecordType type, uint64_t connection);
+    void flush();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+};
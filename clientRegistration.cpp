@@ -1,142 +1,202 @@
 #include <iostream>
-#include <regex>
 
 #include "Server.hpp"
-#include "regexRules.hpp"
-#include "utils.hpp"  // for parser
-
-// Validate PASS command: extract and compare password
-void Server::registerPassword(Client& client, const std::string& arg, size_t* clientIndex)
+#include "metrics/Probes.hpp"
+#include "nameRules.hpp"
+#include "utils.hpp"  // for parser, lastParam
+
+// Registration state machine. Lines are matched on their command word:
+//
+//   connected --PASS ok--> password given --NICK + USER (any order)--> registered
+//
+// NICK/USER before PASS are refused, a wrong password or a K-line closes the
+// link, and any other command before registration gets 451 (CAP and PONG
+// are ignored). The deadline and the cap on unregistered connections are
+// enforced by the event loop (see expireTimers and acceptClient).
+
+// PASS <password>
+void Server::registerPassword(Client& client, const std::vector<std::string>& params,
+                              size_t* clientIndex)
 {
-    std::size_t found = arg.find("PASS");
-    if (found != std::string::npos && arg.length() > 5)
+    if (!client.getPassword().empty())
+        return;
+    if (params.size() < 2)
     {
-        std::string pwd = arg.substr(found + 5);
+        _metrics.registrationFailures[REG_INVALID_PARAMS]++;
+        sendError(client.getFd(), "461", "*", "PASS :Not enough parameters");
+        return;
+    }
 
-        // Удаляем пробелы, \r, \n по краям
-        pwd.erase(0, pwd.find_first_not_of(" \r\n"));
-        pwd.erase(pwd.find_last_not_of(" \r\n") + 1);
+    std::string pwd = lastParam(params, 1);
+    if (pwd == _password)
+    {
+        std::string msg = "Password accepted.\r\n";
+        sendMessage(client.getFd(), msg);
+        client.setPassword(pwd);
+        return;
+    }
 
-        if (pwd == _password)
-        {
-            std::string msg = "Password accepted.\r\n";
-            send(client.getFd(), msg.c_str(), msg.length(), 0);
-            client.setPassword(pwd);
-        }
-        else
-        {
-            std::string msg = "ERROR :Incorrect password. Connection closed.\r\n";
-            send(client.getFd(), msg.c_str(), msg.length(), 0);
-            std::cerr << "[WARN] Incorrect password from client fd=" << client.getFd() << std::endl;
+    _metrics.registrationFailures[REG_BAD_PASSWORD]++;
+    std::string msg = "ERROR :Incorrect password. Connection closed.\r\n";
+    sendMessage(client.getFd(), msg);
+    std::cerr << "[WARN] Incorrect password from client fd=" << client.getFd() << std::endl;
 
-            // Safely disconnect the client
-            handleClientDisconnect(client.getFd(), clientIndex);
-        }
-    }
+    int fd = client.getFd();
+    handleClientDisconnect(fd, clientIndex);
+    closeLater(fd);
 }
 
-// Validate NICK command: extract, check uniqueness, set nickname
-void Server::registerNickname(Client& client, const std::string& arg)
+// NICK <nickname>
+void Server::registerNickname(Client& client, const std::vector<std::string>& params)
 {
-    std::size_t found = arg.find("NICK");
-    if (found != std::string::npos && arg.length() > 5)
+    if (client.getPassword().empty())
     {
-        if (client.getPassword().empty())
-        {
-            std::string msg = "ERROR :Please enter PASS before NICK\r\n";
-            send(client.getFd(), msg.c_str(), msg.length(), 0);
-            return;
-        }
+        _metrics.registrationFailures[REG_PASS_REQUIRED]++;
+        std::string msg = "ERROR :Please enter PASS before NICK\r\n";
+        sendMessage(client.getFd(), msg);
+        return;
+    }
+    if (params.size() < 2)
+    {
+        _metrics.registrationFailures[REG_INVALID_PARAMS]++;
+        sendError(client.getFd(), "431", "*", ":No nickname given");
+        return;
+    }
 
-        std::string nick = arg.substr(found + 5);
-        if (std::regex_match(nick, incorrectRegex))
-        {
-            std::cerr << "[WARN] Rejected nick with invalid pattern from fd=" << client.getFd()
-                      << std::endl;
-            return;
-        }
+    std::string nick = lastParam(params, 1);
+    NameCheck check = checkNick(nick, _config.nickLength);
+    if (check != NAME_OK)
+    {
+        _metrics.registrationFailures[REG_INVALID_PARAMS]++;
+        sendError(client.getFd(), "432", "*",
+                  nick + " :Erroneous nickname (" + nameCheckReason(check) + ")");
+        return;
+    }
 
-        int nickCount = 1;
-        std::string newNick = nick;
-        while (!isUniqueNick(newNick))
+    // Taken nicks get a numeric suffix, cutting the nick short if the
+    // suffix would not fit in nickLength. The nick keeps at least its first
+    // character, so the result is still valid; when even that does not fit,
+    // the client has to pick another nick, as with NICK.
+    int nickCount = 1;
+    std::string newNick = nick;
+    while (!isUniqueNick(newNick))
+    {
+        std::string suffix = std::to_string(nickCount++);
+        if (suffix.size() >= _config.nickLength)
         {
-            newNick = nick + std::to_string(nickCount++);
+            sendError(client.getFd(), "433", "*", nick + " :Nickname is already in use");
+            return;
         }
-
-        client.setNickname(newNick);
+        newNick = nick.substr(0, _config.nickLength - suffix.size()) + suffix;
     }
+
+    renameClient(client, newNick);
 }
 
-// Validate USER command: extract and assign username
-void Server::registerUser(Client& client, const std::string& arg)
+// USER <username> <mode> <unused> :<realname>
+void Server::registerUser(Client& client, const std::vector<std::string>& params)
 {
-    std::size_t found = arg.find("USER");
-    if (found != std::string::npos && arg.length() > 5)
+    if (client.getPassword().empty())
     {
-        if (client.getPassword().empty())
-        {
-            std::string msg = "ERROR :Please enter PASS before USER\r\n";
-            send(client.getFd(), msg.c_str(), msg.length(), 0);
-            return;
-        }
-
-        std::vector<std::string> params;
-        parser(arg, params, ' ');
+        _metrics.registrationFailures[REG_PASS_REQUIRED]++;
+        std::string msg = "ERROR :Please enter PASS before USER\r\n";
+        sendMessage(client.getFd(), msg);
+        return;
+    }
+    if (params.size() < 2)
+    {
+        _metrics.registrationFailures[REG_INVALID_PARAMS]++;
+        sendError(client.getFd(), "461", "*", "USER :Not enough parameters");
+        return;
+    }
 
-        if (params.size() >= 2)
-        {
-            std::string username = params.at(1);
-            if (std::regex_match(username, incorrectRegex))
-            {
-                std::cerr << "[WARN] Rejected username with invalid pattern from fd="
-                          << client.getFd() << std::endl;
-                return;
-            }
-            client.setUsername(username);
-        }
+    std::string username = params.at(1);
+    if (checkUser(username) != NAME_OK)
+    {
+        _metrics.registrationFailures[REG_INVALID_PARAMS]++;
+        std::cerr << "[WARN] Rejected invalid username from fd=" << client.getFd() << std::endl;
+        return;
     }
+    client.setUsername(username);
 }
 
-// Final authentication: if all fields are set, welcome the client
-void Server::authenticate(Client& client, const std::string& arg, size_t* clientIndex)
+// Final step: once PASS, NICK and USER are all in, refuse K-lined clients,
+// then welcome the client and hand its timer over from the registration
+// deadline to keepalive.
+void Server::completeRegistration(Client& client, size_t* clientIndex)
 {
-    if (client.getPassword().empty())
-        registerPassword(client, arg, clientIndex);
-    if (client.getNick().empty())
-        registerNickname(client, arg);
-    if (client.getUser().empty())
-        registerUser(client, arg);
+    if (client.getPassword().empty() || client.getNick().empty() || client.getUser().empty())
+        return;
 
-    if (!client.getPassword().empty() && !client.getNick().empty() && !client.getUser().empty())
+    if (isKlined(client))
     {
-        std::string msg = ":ft_irc 001 " + client.getNick() +
-                          " :Registration successful. You connected to the IRC Network, " +
-                          client.getNick() + "!\r\n";
-        send(client.getFd(), msg.c_str(), msg.length(), 0);
-
-        msg = ":ft_irc 002 " + client.getNick() + " :Your host is ft_irc, running version 42\r\n";
-        send(client.getFd(), msg.c_str(), msg.length(), 0);
-
-        msg = ":ft_irc 005 " + client.getNick() +
-              " INVITE MODE JOIN KICK TOPIC PRIVMSG/MSG NICK QUIT :are supported by "
-              "this server\r\n";
-        send(client.getFd(), msg.c_str(), msg.length(), 0);
-
-        client.setAsRegistered();
-        std::cout << "[INFO] Client fd=" << client.getFd() << " successfully authenticated."
-                  << std::endl;
+        _metrics.registrationFailures[REG_KLINED]++;
+        int fd = client.getFd();
+        sendError(fd, "465", client.getNick(), ":You are banned from this server");
+        sendMessage(fd, "ERROR :Closing Link: " + client.getIPa() + " (K-lined)\r\n");
+        handleClientDisconnect(fd, clientIndex);
+        closeLater(fd);
+        return;
     }
+
+    std::string msg = ":ft_irc 001 " + client.getNick() +
+                      " :Registration successful. You connected to the IRC Network, " +
+                      client.getNick() + "!\r\n";
+    sendMessage(client.getFd(), msg);
+
+    msg = ":ft_irc 002 " + client.getNick() + " :Your host is ft_irc, running version 42\r\n";
+    sendMessage(client.getFd(), msg);
+
+    msg = ":ft_irc 005 " + client.getNick() +
+          " INVITE MODE JOIN KICK TOPIC PRIVMSG/MSG NICK QUIT :are supported by "
+          "this server\r\n";
+    sendMessage(client.getFd(), msg);
+
+    client.setAsRegistered();
+    --_unregistered;
+    armKeepalive(client.getFd());
+    _metrics.registrationsCompleted++;
+    IRC_PROBE2(client__registered, client.getFd(), client.getNick().c_str());
+    std::cout << "[INFO] Client fd=" << client.getFd() << " successfully authenticated."
+              << std::endl;
 }
 
-// Entry point: find client by fd and process registration
+// Entry point: find client by fd and advance its registration
 void Server::registerClient(int clientFd, const std::string& arg, size_t* clientIndex)
 {
-    for (std::deque<Client>::iterator it = _clients.begin(); it != _clients.end(); ++it)
+    Client* client = getClientObjByFd(clientFd);
+    if (!client)
+        return;  // refused earlier in this read; the link closes at tick end
+
+    std::vector<std::string> params;
+    parser(arg, params, ' ');
+    if (params.empty())
+        return;
+
+    std::string command = toUpperCase(params[0]);
+    if (command == "PASS")
+        registerPassword(*client, params, clientIndex);
+    else if (command == "NICK")
+        registerNickname(*client, params);
+    else if (command == "USER")
+        registerUser(*client, params);
+    else if (command == "QUIT")
     {
-        if (it->getFd() == clientFd)
-        {
-            authenticate(*it, arg, clientIndex);
-            return;
-        }
+        _metrics.registrationFailures[REG_QUIT]++;
+        sendMessage(clientFd, "ERROR :Closing Link: " + client->getIPa() + " (Client Quit)\r\n");
+        handleClientDisconnect(clientFd, clientIndex);
+        closeLater(clientFd);
+        return;
     }
+    else if (command == "CAP" || command == "PONG")
+        return;
+    else
+    {
+        _metrics.registrationFailures[REG_NOT_REGISTERED]++;
+        sendError(clientFd, "451", "*", ":You have not registered");
+        return;
+    }
+
+    if ((client = getClientObjByFd(clientFd)))
+        completeRegistration(*client, clientIndex);
 }
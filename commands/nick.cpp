@@ -1,12 +1,10 @@
 #include "nick.hpp"
 #include "../Server.hpp"
+#include "../nameRules.hpp"
 #include "../utils.hpp"
 
-#include <regex>
 #include <iostream>
 
-extern std::regex incorrectRegex;
-
 // Broadcast nickname change and update the client
 static void broadcastAndUpdateNickname(Server& server, int clientFd, const std::string& newNick)
 {
@@ -16,8 +14,8 @@ static void broadcastAndUpdateNickname(Server& server, int clientFd, const std::
     std::string msg = ":" + currentNick + "!~" + client->getUser() + "@" + client->getIPa() +
                       " NICK " + newNick + "\r\n";
 
-    send(clientFd, msg.c_str(), msg.length(), 0);
-    client->setNickname(newNick);
+    sendMessage(clientFd, msg);
+    server.renameClient(*client, newNick);
 }
 
 // Validate and apply nickname if it's allowed
@@ -29,23 +27,11 @@ static void validateNick(Server& server, int clientFd, const std::string& newNic
     // First, trim whitespace from the nickname
     std::string trimmedNick = trimWhitespace(newNick);
 
-    if (trimmedNick.empty())
-    {
-        sendError(server, clientFd, "432", currentNick, newNick + " :Erroneous nickname (empty)");
-        return;
-    }
-
-    if (trimmedNick.find(' ') != std::string::npos)
-    {
-        sendError(server, clientFd, "432", currentNick,
-                  trimmedNick + " :Erroneous nickname (contains space)");
-        return;
-    }
-
-    if (std::regex_match(trimmedNick, incorrectRegex))
+    NameCheck check = checkNick(trimmedNick, server.getConfig().nickLength);
+    if (check != NAME_OK)
     {
         sendError(server, clientFd, "432", currentNick,
-                  trimmedNick + " :Erroneous nickname (invalid pattern)");
+                  trimmedNick + " :Erroneous nickname (" + nameCheckReason(check) + ")");
         return;
     }
 
@@ -80,7 +66,7 @@ void executeNick(Server& server, int clientFd, const std::string& arg)
     }
 
     Client* client = server.getClientObjByFd(clientFd);
-    std::string trimmedNick = trimWhitespace(params.at(1));
+    std::string trimmedNick = trimWhitespace(lastParam(params, 1));
     if (client->getNick() == trimmedNick)
         return;
 
@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "../Server.hpp"
+#include "../metrics/Trace.hpp"
 #include "../utils.hpp"
 
 static void deliverMessage(Server& server, int senderFd,
@@ -23,20 +24,21 @@ static void deliverMessage(Server& server, int senderFd,
     if (targetClient) {
         std::string fullMessage = prefix + " " + command + " " + trimmedTarget +
                                   " :" + message + "\r\n";
-        send(targetClient->getFd(), fullMessage.c_str(), fullMessage.length(),
-             0);
+        sendMessage(targetClient->getFd(), fullMessage);
         return;
     }
 
     // Else, maybe it's a channel
     Channel* channel = server.findChannel(normalizedTarget);
     if (channel) {
+        if (channel->isBanned(sender) && !channel->isOperator(sender))
+            return;
         std::string fullMessage = prefix + " " + command + " " +
                                   channel->getName() + " :" + message + "\r\n";
         for (Client* member : channel->getClients()) {
             if (member->getFd() != senderFd) {
-                send(member->getFd(), fullMessage.c_str(), fullMessage.length(),
-                     0);
+                TraceSpan sendSpan("send", senderFd, member->getFd());
+                sendMessage(member->getFd(), fullMessage);
             }
         }
         return;
@@ -1,5 +1,5 @@
 #include "../Server.hpp"
-#include <sys/socket.h>
+#include "../utils.hpp"
 
 void executePing(Server& server, int clientFd, const std::string& arg)
 {
@@ -7,5 +7,5 @@ void executePing(Server& server, int clientFd, const std::string& arg)
     size_t pos = arg.find("PING");
     std::string token = (pos != std::string::npos) ? arg.substr(pos + 4) : "";
     std::string response = "PONG" + token + "\r\n";
-    send(clientFd, response.c_str(), response.length(), 0);
+    sendMessage(clientFd, response);
 }
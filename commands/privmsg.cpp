@@ -3,10 +3,13 @@
 #include <set>
 
 #include "../Server.hpp"
+#include "../metrics/ProfScope.hpp"
+#include "../metrics/Trace.hpp"
 #include "../utils.hpp"
 
 void executePrivmsg(Server& server, int clientFd, const std::string& fullMessage)
 {
+    PROF_SCOPE("executePrivmsg");
     try
     {
         std::vector<std::string> tokens;
@@ -45,7 +48,8 @@ void executePrivmsg(Server& server, int clientFd, const std::string& fullMessage
                     continue;
                 }
 
-                if (!channel->isInChannel(sender))
+                if (!channel->isInChannel(sender) ||
+                    (channel->isBanned(sender) && !channel->isOperator(sender)))
                 {
                     sendError(clientFd, "404", sender->getNick(),
                               target + " :Cannot send to channel");
@@ -74,7 +78,8 @@ void executePrivmsg(Server& server, int clientFd, const std::string& fullMessage
                         if (clients[i] && clients[i]->getFd() != clientFd &&
                             sentFds.insert(clients[i]->getFd()).second)
                         {
-                            send(clients[i]->getFd(), msg.c_str(), msg.length(), 0);
+                            TraceSpan sendSpan("send", clientFd, clients[i]->getFd());
+                            sendMessage(clients[i]->getFd(), msg);
                         }
                     }
                 }
@@ -111,7 +116,7 @@ void executePrivmsg(Server& server, int clientFd, const std::string& fullMessage
                                 std::string msg = ":" + sender->getNick() + "!~" +
                                                   sender->getUser() + "@" + sender->getIPa() +
                                                   " PRIVMSG " + target + " :" + message + "\r\n";
-                                send(clientFd, msg.c_str(), msg.length(), 0);
+                                sendMessage(clientFd, msg);
                             }
                             continue;
                         }
@@ -130,7 +135,7 @@ void executePrivmsg(Server& server, int clientFd, const std::string& fullMessage
                     std::string msg = ":" + sender->getNick() + "!~" + sender->getUser() + "@" +
                                       sender->getIPa() + " PRIVMSG " + target + " :" + message +
                                       "\r\n";
-                    send(recipient->getFd(), msg.c_str(), msg.length(), 0);
+                    sendMessage(recipient->getFd(), msg);
                 }
             }
         }
@@ -1,7 +1,7 @@
 #include "../Server.hpp"
+#include "../net/IoLayer.hpp"
 #include "../utils.hpp"
 #include <iostream>
-#include <unistd.h>  // close()
 
 void executeQuit(Server& server, int clientFd, const std::string& arg)
 {
@@ -39,6 +39,6 @@ void executeQuit(Server& server, int clientFd, const std::string& arg)
     catch (const std::exception& e)
     {
         std::cerr << "[QUIT] Error removing client: " << e.what() << std::endl;
-        close(clientFd);  // Just in case socket wasn't closed
+        io().close(clientFd);  // Just in case socket wasn't closed
     }
 }
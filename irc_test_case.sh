@@ -8,18 +8,18 @@ LOG2="client2_output.log"
 LOG3="client3_output.log"
 rm -f $LOG1 $LOG2 $LOG3
 
-# Первый клиент: Jo[n\doe~
+# Первый клиент: Jo[n\doe^
 coproc CLIENT1 { nc $SERVER $PORT | tee "$LOG1"; }
 sleep 1
 echo "PASS testpass" >&"${CLIENT1[1]}"
 sleep 1
-echo "NICK Jo[n\\doe~" >&"${CLIENT1[1]}"
+echo "NICK Jo[n\\doe^" >&"${CLIENT1[1]}"
 sleep 1
 echo "USER user1 0 * :Test User 1" >&"${CLIENT1[1]}"
 sleep 1
 echo "JOIN #chan[one]" >&"${CLIENT1[1]}"
 sleep 1
-echo "PRIVMSG #chan[one] :Hello from Jo[n\\doe~" >&"${CLIENT1[1]}"
+echo "PRIVMSG #chan[one] :Hello from Jo[n\\doe^" >&"${CLIENT1[1]}"
 sleep 1
 
 # Второй клиент: Jo{n|doe^
@@ -47,13 +47,13 @@ echo "USER user3 0 * :Test User 3" >&"${CLIENT3[1]}"
 sleep 1
 
 # PRIVMSG по нику
-echo "PRIVMSG Jo{n|doe^ :Hello from Jo[n\\doe~" >&"${CLIENT1[1]}"
+echo "PRIVMSG Jo{n|doe^ :Hello from Jo[n\\doe^" >&"${CLIENT1[1]}"
 sleep 1
-echo "PRIVMSG Jo[n\\doe~ :Hi from Jo{n|doe^" >&"${CLIENT2[1]}"
+echo "PRIVMSG Jo[n\\doe^ :Hi from Jo{n|doe^" >&"${CLIENT2[1]}"
 sleep 1
 
 # MULTIPLE PRIVMSG: 2 похожих + 1 разный
-echo "PRIVMSG Jo[n\\doe~,Jo{n|doe^,DifferentUser :This is a multi-target message" >&"${CLIENT1[1]}"
+echo "PRIVMSG Jo[n\\doe^,Jo{n|doe^,DifferentUser :This is a multi-target message" >&"${CLIENT1[1]}"
 sleep 1
 
 # TOPIC
@@ -71,7 +71,7 @@ echo "KICK #chan[one] Jo{n|doe^ :Testing KICK logic" >&"${CLIENT1[1]}"
 sleep 1
 
 # NICK change
-echo "NICK jO[n\\doe~" >&"${CLIENT1[1]}"
+echo "NICK jO[n\\doe^" >&"${CLIENT1[1]}"
 sleep 1
 echo "NICK JO{N|DOE^" >&"${CLIENT2[1]}"
 sleep 1
@@ -1,14 +1,23 @@
 #include "Server.hpp"
+#include "metrics/AllocTrack.hpp"
+#include "metrics/ProfScope.hpp"
+#include <csignal>
 #include <cstdlib>
 #include <iostream>
 #include <string>
 
+static void handleShutdownSignal(int signum)
+{
+    (void)signum;
+    Server::requestShutdown();
+}
+
 int main(int argc, char *argv[])
 {
-    // optional fourth argument: -debug
-    if (argc < 3 || argc > 4)
+    // optional trailing arguments: -debug, -config <file>
+    if (argc < 3)
     {
-        std::cerr << "Usage: ./ircserv <port> <password> [-debug]" << std::endl;
+        std::cerr << "Usage: ./ircserv <port> <password> [-debug] [-config <file>]" << std::endl;
         return 1;
     }
 
@@ -16,8 +25,21 @@ int main(int argc, char *argv[])
     int port = std::atoi(argv[1]);
     std::string password = argv[2];
     bool debugMode = false;
-    if (argc == 4 && std::string(argv[3]) == "-debug")
-        debugMode = true;
+    std::string configPath;
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-debug")
+            debugMode = true;
+        else if (arg == "-config" && i + 1 < argc)
+            configPath = argv[++i];
+        else
+        {
+            std::cerr << "Usage: ./ircserv <port> <password> [-debug] [-config <file>]"
+                      << std::endl;
+            return 1;
+        }
+    }
 
     // Validate port range
     if (port <= 0 || port > 65535)
@@ -28,8 +50,23 @@ int main(int argc, char *argv[])
 
     try
     {
+        ServerConfig config;
+        if (!configPath.empty())
+            config.loadFile(configPath);
+
+        std::signal(SIGINT, handleShutdownSignal);
+        std::signal(SIGTERM, handleShutdownSignal);
+        // A peer that vanished mid fan-out must cost an EPIPE, not the process.
+        std::signal(SIGPIPE, SIG_IGN);
+#ifdef IRC_PROFILE
+        std::signal(SIGUSR1, profRequestReport);
+#endif
+#ifdef IRC_ALLOC_TRACK
+        std::signal(SIGUSR1, allocRequestReport);
+#endif
+
         // Create and run the server with debugMode set accordingly
-        Server server(port, password, debugMode);
+        Server server(port, password, debugMode, config);
         server.run();
     }
     catch (const std::exception &e)
@@ -0,0 +1,139 @@
+// main_test_cidr.cpp
+#include <arpa/inet.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "net/CidrTree.hpp"
+#include "testCheck.hpp"
+#include "testSim.hpp"
+
+static uint32_t ip(const char* text) {
+    in_addr addr;
+    inet_pton(AF_INET, text, &addr);
+    return ntohl(addr.s_addr);
+}
+
+static bool in(const CidrTree& tree, const char* text) { return tree.contains(ip(text)); }
+
+static void testTree() {
+    CidrTree tree;
+    section("Nested prefixes, longest first");
+    check(tree.insert(ip("10.1.2.0"), 24), "insert 10.1.2.0/24");
+    check(tree.insert(ip("10.1.0.0"), 16), "insert 10.1.0.0/16 above it");
+    check(tree.insert(ip("10.0.0.0"), 8), "insert 10.0.0.0/8 above both");
+    check(!tree.insert(ip("10.1.0.0"), 16), "10.1.0.0/16 again is refused");
+    check(tree.size() == 3, "three prefixes");
+    check(in(tree, "10.1.2.3") && in(tree, "10.1.9.9") && in(tree, "10.200.0.1"),
+          "addresses under each level match");
+    check(!in(tree, "11.0.0.1") && !in(tree, "9.255.255.255"), "neighbours of 10/8 do not");
+
+    section("Siblings split a shared prefix");
+    check(tree.insert(ip("192.168.1.0"), 24), "insert 192.168.1.0/24");
+    check(tree.insert(ip("192.168.2.0"), 24), "insert 192.168.2.0/24");
+    check(in(tree, "192.168.1.5") && in(tree, "192.168.2.5"), "both siblings match");
+    check(!in(tree, "192.168.0.5") && !in(tree, "192.168.3.5"),
+          "the split node itself is not a ban");
+    check(tree.insert(ip("192.168.0.0"), 22), "insert the split prefix 192.168.0.0/22");
+    check(in(tree, "192.168.0.5") && in(tree, "192.168.3.5"), "now it is");
+    check(tree.insert(ip("203.0.113.7"), 32), "insert a /32");
+    check(in(tree, "203.0.113.7") && !in(tree, "203.0.113.6"), "a /32 is one address");
+
+    section("Address order");
+    std::vector<std::pair<uint32_t, int>> want = {
+        {ip("10.0.0.0"), 8},     {ip("10.1.0.0"), 16},    {ip("10.1.2.0"), 24},
+        {ip("192.168.0.0"), 22}, {ip("192.168.1.0"), 24}, {ip("192.168.2.0"), 24},
+        {ip("203.0.113.7"), 32}};
+    check(tree.prefixes() == want, "prefixes() lists all seven, each before those inside it");
+
+    section("Erasing from the middle of a chain");
+    check(!tree.erase(ip("10.2.0.0"), 16), "unknown prefix is not erased");
+    check(tree.erase(ip("10.0.0.0"), 8), "erase 10.0.0.0/8");
+    check(!in(tree, "10.200.0.1"), "10.200.0.1 no longer matches");
+    check(in(tree, "10.1.9.9") && in(tree, "10.1.2.3"), "the /16 and /24 below still match");
+    check(tree.erase(ip("10.1.0.0"), 16), "erase 10.1.0.0/16");
+    check(!in(tree, "10.1.9.9") && in(tree, "10.1.2.3"), "only the /24 is left there");
+    check(tree.erase(ip("192.168.0.0"), 22), "erase the split prefix");
+    check(!in(tree, "192.168.0.5") && in(tree, "192.168.1.5"),
+          "its siblings stay, the rest of it goes");
+    check(tree.size() == 4, "four prefixes left");
+
+    section("The whole address space");
+    check(tree.insert(0, 0), "insert 0.0.0.0/0");
+    check(in(tree, "1.2.3.4") && in(tree, "255.255.255.255"), "everything matches");
+    check(tree.erase(0, 0), "erase it");
+    check(!in(tree, "1.2.3.4"), "and nothing else does");
+
+}
+
+static bool closedWith(TestNet& net, int fd, const std::string& reason) {
+    std::string out = net.output(fd);
+    return !net.isOpen(fd) && out.find("ERROR :Closing Link") != std::string::npos &&
+           out.find(reason) != std::string::npos;
+}
+
+static void testServerBans() {
+    ServerConfig config;
+    config.klines.push_back("~bad@*");
+    TestNet net(config);
+    Server& server = net.server();
+
+    section("K-lines");
+    int bad = net.connect("10.1.1.1");
+    net.send(bad, "PASS " + std::string(TestNet::kPassword));
+    net.send(bad, "NICK bad");
+    net.send(bad, "USER bad 0 * :bad");
+    std::string out = net.output(bad);
+    check(hasReply(out, "465") && !net.isOpen(bad), "a config K-line refuses registration (465)");
+
+    int alice = net.client("alice", "10.1.1.2");
+    int bob = net.client("bob", "10.2.0.1");
+    check(net.isOpen(alice) && !server.isKlined(*server.getClientObjByNick("alice")),
+          "other users register");
+    check(net.call([&] {
+              Client client(900, "192.0.2.1");
+              client.setUsername("BAD");
+              return server.isKlined(client);
+          }),
+          "isKlined matches ~user@ip, ignoring case");
+
+    for (int fd : {alice, bob}) net.send(fd, "JOIN #k");
+    net.output(bob);
+    check(net.call([&] { return server.addKline("~alice@10.1.*"); }), "add a K-line at run time");
+    check(closedWith(net, alice, "K-lined"), "it closes the registered client it matches");
+    check(net.isOpen(bob) && net.output(bob).find("QUIT") != std::string::npos,
+          "who quits from its channels");
+    check(!net.call([&] { return server.addKline("~ALICE@10.1.*"); }),
+          "the same K-line again is refused");
+
+    section("D-lines");
+    int carol = net.client("carol", "10.3.4.5");
+    int dave = net.connect("10.3.9.9");  // not registered yet
+    int erin = net.client("erin", "10.4.0.1");
+    check(net.call([&] { return server.addDline(ip("10.3.0.0"), 16); }),
+          "add 10.3.0.0/16 at run time");
+    check(closedWith(net, carol, "D-lined") && closedWith(net, dave, "D-lined"),
+          "it closes every connection from 10.3/16, registered or not");
+    check(net.isOpen(erin) && net.isOpen(bob), "and only those");
+    check(!net.call([&] { return server.addDline(ip("10.3.0.0"), 16); }),
+          "the same D-line again is refused");
+
+    int late = net.connect("10.3.200.1");
+    check(!net.isOpen(late), "a new connection from 10.3/16 is refused at accept");
+    sockaddr_in addr = {};
+    addr.sin_addr.s_addr = htonl(ip("10.3.1.1"));
+    check(server.isDlined(addr), "isDlined agrees");
+
+    std::string bans = server.renderBans();
+    check(bans.find("dline 10.3.0.0/16\n") != std::string::npos &&
+              bans.find("kline *!~bad@*") != std::string::npos &&
+              bans.find("kline *!~alice@10.1.*") != std::string::npos,
+          "renderBans lists config and run-time bans");
+}
+
+int main() {
+    testTree();
+    testServerBans();
+    return testResult();
+}
@@ -0,0 +1,123 @@
+// main_test_masklist.cpp
+#include <string>
+
+#include "modes/MaskList.hpp"
+#include "testCheck.hpp"
+#include "testSim.hpp"
+#include "utils.hpp"
+
+// The subject is folded the way Channel::isBanned folds a member.
+static bool hits(const MaskList& list, const std::string& nick, const std::string& user,
+                 const std::string& host) {
+    return list.matches(ircCaseFold(nick), ircCaseFold(user), host);
+}
+
+static void testIndex() {
+    section("Partial masks");
+    check(MaskList::canonical("Troll") == "Troll!*@*", "nick -> nick!*@*");
+    check(MaskList::canonical("~u@host") == "*!~u@host", "user@host -> *!user@host");
+    check(MaskList::canonical("n!u") == "n!u@*", "nick!user -> nick!user@*");
+    check(MaskList::canonical("10.0.0.0") == "*!*@10.0.0.0", "address -> *!*@address");
+    check(MaskList::canonical("!@") == "*!*@*", "empty parts -> *");
+
+    section("One mask per index path");
+    MaskList list;
+    check(list.add("*!~u@example.org", "op", 0), "literal host");
+    check(list.add("*!*@10.0.*", "op", 0), "host prefix");
+    check(list.add("*!*@192.168.1.?", "op", 0), "host prefix ending in '?'");
+    check(list.add("*!*@*.isp.net", "op", 0), "host suffix");
+    check(list.add("Troll!*@*", "op", 0), "literal nick");
+    check(list.add("guest*!*@*", "op", 0), "wildcard nick, tried one by one");
+    check(!list.add("TROLL!*@*", "op", 0), "the same mask in another case is refused");
+
+    check(hits(list, "alice", "~u", "example.org"), "literal host, same user");
+    check(!hits(list, "alice", "~v", "example.org"), "literal host, other user");
+    check(hits(list, "alice", "~a", "10.0.3.4"), "10.0.* matches 10.0.3.4");
+    check(!hits(list, "alice", "~a", "10.1.0.1"), "10.0.* misses 10.1.0.1");
+    check(hits(list, "alice", "~a", "192.168.1.7"), "192.168.1.? matches 192.168.1.7");
+    check(!hits(list, "alice", "~a", "192.168.1.70"), "'?' is one character");
+    check(hits(list, "alice", "~a", "dsl-1.pool.isp.net"), "*.isp.net matches a subdomain");
+    check(!hits(list, "alice", "~a", "isp.net"), "*.isp.net needs the leading dot");
+    check(!hits(list, "alice", "~a", "evilisp.net"), "a suffix is not a substring");
+    check(hits(list, "tROLL", "~a", "anywhere"), "the nick index is case-folded");
+    check(!hits(list, "trolls", "~a", "anywhere"), "and exact");
+    check(hits(list, "guest42", "~a", "anywhere"), "guest* matches guest42");
+    check(!hits(list, "alice", "~a", "anywhere"), "nothing matches alice@anywhere");
+
+    section("Removing rebuilds the index");
+    check(!list.remove("*!*@10.1.*"), "a mask that is not set is not removed");
+    check(list.remove("*!*@10.0.*") && list.remove("troll!*@*"), "remove 10.0.* and troll");
+    check(list.size() == 4, "four masks left");
+    check(!hits(list, "alice", "~a", "10.0.3.4") && !hits(list, "troll", "~a", "anywhere"),
+          "the removed masks no longer match");
+    check(hits(list, "alice", "~u", "example.org") && hits(list, "alice", "~a", "192.168.1.7") &&
+              hits(list, "alice", "~a", "dsl-1.pool.isp.net") &&
+              hits(list, "guest42", "~a", "anywhere"),
+          "the others still do, on every path");
+    check(list.add("*!*@10.0.*", "op", 0) && hits(list, "alice", "~a", "10.0.3.4"),
+          "a removed mask can be set again");
+}
+
+static void testChannel() {
+    TestNet net;
+    int op = net.client("op", "10.0.0.1");
+    int eve = net.client("eve", "10.9.9.9");
+    int bob = net.client("bob", "192.168.5.5");
+    for (int fd : {op, eve, bob}) net.send(fd, "JOIN #c");
+    for (int fd : {op, eve, bob}) net.output(fd);
+
+    section("+b on a channel");
+    net.send(op, "MODE #c +b *!*@10.9.*");
+    check(net.output(bob).find("MODE #c +b *!*@10.9.*") != std::string::npos,
+          "the ban is announced to the channel");
+    net.send(op, "MODE #c +b");
+    std::string list = net.output(op);
+    check(hasReply(list, "367") && hasReply(list, "368"), "MODE #c +b lists it (367, 368)");
+
+    net.send(eve, "PRIVMSG #c :hi");
+    check(hasReply(net.output(eve), "404"), "a banned member's PRIVMSG gets 404");
+    check(net.output(bob).empty(), "and reaches nobody");
+    net.send(eve, "NOTICE #c :hi");
+    check(net.output(eve).empty() && net.output(bob).empty(), "a NOTICE is dropped silently");
+    net.send(bob, "PRIVMSG #c hello");
+    check(net.output(eve).find("PRIVMSG #c") != std::string::npos,
+          "a banned member still receives");
+
+    net.send(eve, "PART #c");
+    net.send(eve, "JOIN #c");
+    check(hasReply(net.output(eve), "474"), "JOIN gets 474");
+    check(!net.server().findChannel("#c")->isInChannel(net.server().getClientObjByNick("eve")),
+          "and does not join");
+
+    section("+e and +I");
+    net.send(op, "MODE #c +e EVE");
+    net.send(eve, "JOIN #c");
+    check(!hasReply(net.output(eve), "474") &&
+              net.server().findChannel("#c")->isInChannel(net.server().getClientObjByNick("eve")),
+          "an exception lets a banned client join");
+    net.send(op, "MODE #c -e eve");
+    net.output(eve);
+    net.send(eve, "PRIVMSG #c :hi");
+    check(hasReply(net.output(eve), "404"), "removing it bans the member again");
+
+    int carol = net.client("carol", "172.16.0.1");
+    net.send(op, "MODE #c +i");
+    net.send(carol, "JOIN #c");
+    check(hasReply(net.output(carol), "473"), "+i refuses an uninvited client");
+    net.send(op, "MODE #c +I *!*@172.16.*");
+    net.send(carol, "JOIN #c");
+    check(!hasReply(net.output(carol), "473") &&
+              net.server().findChannel("#c")->isInChannel(net.server().getClientObjByNick("carol")),
+          "+I lets a matching client in");
+
+    net.send(op, "MODE #c -b *!*@10.9.*");
+    net.output(bob);
+    net.send(eve, "PRIVMSG #c back");
+    check(net.output(bob).find("PRIVMSG #c") != std::string::npos, "-b lifts the ban");
+}
+
+int main() {
+    testIndex();
+    testChannel();
+    return testResult();
+}
@@ -0,0 +1,110 @@
+// main_test_modes.cpp
+#include <string>
+
+#include "Channel.hpp"
+#include "Client.hpp"
+#include "modes/ModeHandler.hpp"
+#include "testCheck.hpp"
+#include "testSim.hpp"
+
+static std::string line(const ModeChanges& changes) {
+    return changes.line("op!~op@127.0.0.1", "#test");
+}
+
+static void testMerge() {
+    section("Merging changes into one MODE line");
+    ModeChanges changes;
+    check(changes.empty(), "starts empty");
+    changes.add(true, 'i');
+    changes.add(true, 'k', "secret");
+    changes.add(false, 'o', "bob");
+    changes.add(false, 'l');
+    changes.add(true, 't');
+    check(line(changes) == ":op!~op@127.0.0.1 MODE #test +ik-ol+t secret bob\r\n",
+          "signs only where they flip, parameters in order");
+
+    ModeChanges removals;
+    removals.add(false, 'i');
+    removals.add(false, 't');
+    check(line(removals) == ":op!~op@127.0.0.1 MODE #test -it\r\n", "a leading '-' is kept");
+}
+
+static void testModeCommand() {
+    TestNet net;
+    int op = net.client("op", "10.0.0.1");
+    int bob = net.client("bob", "10.0.0.2");
+    for (int fd : {op, bob}) net.send(fd, "JOIN #c");
+    for (int fd : {op, bob}) net.output(fd);
+
+    section("MODE with several letters");
+    net.send(op, "MODE #c +itk secret");
+    check(net.output(bob) == ":op!~op@10.0.0.1 MODE #c +itk secret\r\n",
+          "members see one merged MODE line");
+    net.send(op, "MODE #c +o-t bob");
+    check(net.output(bob) == ":op!~op@10.0.0.1 MODE #c +o-t bob\r\n",
+          "parameters are taken in letter order");
+    net.send(op, "MODE #c -o bob");
+    net.output(bob);
+
+    net.send(op, "MODE #c +xt");
+    std::string out = net.output(op);
+    check(hasReply(out, "472") && out.find("MODE #c +t\r\n") != std::string::npos,
+          "an unknown letter gets 472, the rest still apply");
+    net.send(op, "MODE #c +l");
+    check(hasReply(net.output(op), "461"), "+l without a limit gets 461");
+
+    net.send(bob, "MODE #c -i");
+    check(hasReply(net.output(bob), "482"), "a non-op gets 482");
+    net.send(bob, "MODE #c +b");
+    check(hasReply(net.output(bob), "368"), "but may list the bans");
+}
+
+static void testRealChanges() {
+    section("Only real state changes are recorded");
+    Channel channel("#test");
+    Client client(100, "127.0.0.1");
+    ModeChanges changes;
+
+    handleInviteOnlyMode(channel, false, changes);
+    handleTopicRestrictMode(channel, false, changes);
+    check(changes.empty(), "-i and -t on a fresh channel change nothing");
+
+    handleInviteOnlyMode(channel, true, changes);
+    handleInviteOnlyMode(channel, true, changes);
+    check(channel.isInviteOnly() && line(changes) == ":op!~op@127.0.0.1 MODE #test +i\r\n",
+          "+i twice is recorded once");
+
+    const std::string key = "secret";
+    handleKeyMode(&client, channel, false, nullptr, changes);
+    handleKeyMode(&client, channel, true, &key, changes);
+    handleKeyMode(&client, channel, true, &key, changes);
+    check(channel.getModeKey() == key &&
+              line(changes) == ":op!~op@127.0.0.1 MODE #test +ik secret\r\n",
+          "-k without a key is skipped, the same key twice is recorded once");
+
+    const std::string five = "5";
+    const std::string junk = "5x";
+    handleLimitMode(&client, channel, false, nullptr, changes);
+    handleLimitMode(&client, channel, true, &five, changes);
+    handleLimitMode(&client, channel, true, &five, changes);
+    handleLimitMode(&client, channel, true, &junk, changes);
+    check(channel.getClientLimit() == 5 &&
+              line(changes) == ":op!~op@127.0.0.1 MODE #test +ikl secret 5\r\n",
+          "-l without a limit is skipped, the same limit once, junk is ignored");
+
+    handleKeyMode(&client, channel, false, nullptr, changes);
+    handleKeyMode(&client, channel, false, nullptr, changes);
+    handleLimitMode(&client, channel, false, nullptr, changes);
+    handleLimitMode(&client, channel, false, nullptr, changes);
+    handleInviteOnlyMode(channel, false, changes);
+    check(!channel.isKeyed() && channel.getClientLimit() == -1 && !channel.isInviteOnly() &&
+              line(changes) == ":op!~op@127.0.0.1 MODE #test +ikl-kli secret 5\r\n",
+          "each removal is recorded once");
+}
+
+int main() {
+    testMerge();
+    testModeCommand();
+    testRealChanges();
+    return testResult();
+}
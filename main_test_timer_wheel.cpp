@@ -0,0 +1,102 @@
+// main_test_timer_wheel.cpp
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "net/TimerWheel.hpp"
+#include "testCheck.hpp"
+
+static const uint64_t kMs = 1000000;  // one tick
+
+// Level 0 spans 256 ticks and the whole wheel 2^26.
+static const uint64_t kWheelTicks = 1ull << 26;
+
+int main() {
+    section("Around the first level-0 wrap");
+    {
+        TimerWheel wheel(kMs, 0);
+        // Last slot before the wrap, the wrap itself, the first slot after
+        // it (filed in level 1 and cascaded down at the wrap), and one a
+        // full level-1 slot further.
+        const uint64_t dues[] = {255, 256, 257, 300, 512, 513};
+        for (int fd = 0; fd < 6; ++fd) wheel.schedule(fd, dues[fd] * kMs);
+        check(wheel.size() == 6, "six timers armed");
+
+        std::vector<int> due;
+        wheel.expire(254 * kMs, due);
+        check(due.empty(), "nothing before 255 ms");
+        wheel.expire(255 * kMs, due);
+        check(due == std::vector<int>{0}, "255 ms fires alone");
+        due.clear();
+        wheel.expire(256 * kMs, due);
+        check(due == std::vector<int>{1}, "256 ms fires at the wrap");
+        due.clear();
+        wheel.expire(299 * kMs, due);
+        check(due == std::vector<int>{2}, "257 ms fires after cascading from level 1");
+        due.clear();
+        wheel.expire(600 * kMs, due);
+        check(due == (std::vector<int>{3, 4, 5}), "the rest fire in due order");
+        check(wheel.size() == 0, "nothing left armed");
+    }
+
+    section("Never early, at most one tick late");
+    {
+        TimerWheel wheel(kMs, 0);
+        // Sub-tick due times spread over levels 0, 1 and 2.
+        std::vector<uint64_t> dues;
+        for (uint64_t ns = 100 * kMs + 1; ns < 20000 * kMs; ns += 37 * kMs + 12345)
+            dues.push_back(ns);
+        for (size_t fd = 0; fd < dues.size(); ++fd) wheel.schedule(static_cast<int>(fd), dues[fd]);
+
+        std::vector<uint64_t> firedAt(dues.size(), 0);
+        std::vector<int> due;
+        for (uint64_t now = 0; now <= 20001 * kMs; now += kMs) {
+            due.clear();
+            wheel.expire(now, due);
+            for (int fd : due) firedAt[fd] = now;
+        }
+        bool early = false, late = false;
+        for (size_t fd = 0; fd < dues.size(); ++fd) {
+            early = early || firedAt[fd] < dues[fd];
+            late = late || firedAt[fd] >= dues[fd] + kMs;
+        }
+        check(wheel.size() == 0, std::to_string(dues.size()) + " timers all fired");
+        check(!early, "none before its due time");
+        check(!late, "none more than one tick late");
+    }
+
+    section("Re-arming and cancelling");
+    {
+        TimerWheel wheel(kMs, 0);
+        wheel.schedule(7, 5000 * kMs);
+        wheel.schedule(7, 10 * kMs);
+        wheel.schedule(8, 20 * kMs);
+        wheel.cancel(8);
+        check(wheel.size() == 1 && wheel.armed(7) && !wheel.armed(8),
+              "one timer per fd, cancel disarms");
+        std::vector<int> due;
+        wheel.expire(5000 * kMs, due);
+        check(due == std::vector<int>{7}, "the re-armed time is the one that fires");
+    }
+
+    section("Past the wheel's span");
+    {
+        TimerWheel wheel(kMs, 0);
+        const uint64_t far = (kWheelTicks + 1000) * kMs;
+        wheel.schedule(3, far);
+        wheel.schedule(4, 100 * kMs);
+        check(wheel.nextWakeNs() <= 100 * kMs, "the near timer sets the next wake-up");
+
+        std::vector<int> due;
+        wheel.expire(100 * kMs, due);
+        check(due == std::vector<int>{4}, "the near timer fires");
+        check(wheel.nextWakeNs() < far, "a parked timer still wakes the loop to re-file it");
+        due.clear();
+        wheel.expire(far - kMs, due);
+        check(due.empty() && wheel.armed(3), "the parked timer survives its slot coming round");
+        wheel.expire(far, due);
+        check(due == std::vector<int>{3}, "and fires when due");
+    }
+
+    return testResult();
+}
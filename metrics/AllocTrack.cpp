@@ -0,0 +1,225 @@
+#include "AllocTrack.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+struct Counters
+{
+    unsigned long long allocs;
+    unsigned long long bytes;
+    unsigned long long frees;
+};
+
+// Connections with an fd at or above kMaxTrackedFd share the last slot.
+const int kMaxTrackedFd = 65536;
+const size_t kTopConnections = 20;
+
+Counters g_tags[ALLOC_TAG_COUNT];
+Counters g_conns[kMaxTrackedFd + 1];
+int g_tag = ALLOC_EVENT_LOOP;
+int g_fd = -1;
+bool g_atexitRegistered = false;
+volatile sig_atomic_t g_reportRequested = 0;
+
+const char* tagName(int tag)
+{
+    switch (tag)
+    {
+        case ALLOC_REGISTER:
+            return "REGISTER";
+        case ALLOC_PARSE:
+            return "PARSE";
+        case ALLOC_EVENT_LOOP:
+            return "EVENT_LOOP";
+        default:
+            return commandName(static_cast<CommandId>(tag));
+    }
+}
+
+void reportAtExit() { allocReport(std::cerr); }
+
+inline void charge(size_t size)
+{
+    Counters& tag = g_tags[g_tag];
+    tag.allocs++;
+    tag.bytes += size;
+    if (g_fd >= 0)
+    {
+        Counters& conn = g_conns[g_fd < kMaxTrackedFd ? g_fd : kMaxTrackedFd];
+        conn.allocs++;
+        conn.bytes += size;
+    }
+}
+
+inline void release(void* ptr)
+{
+    if (!ptr)
+        return;
+    g_tags[g_tag].frees++;
+    if (g_fd >= 0)
+        g_conns[g_fd < kMaxTrackedFd ? g_fd : kMaxTrackedFd].frees++;
+}
+
+void* trackedAlloc(size_t size)
+{
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    charge(size);
+    return ptr;
+}
+
+void* trackedAlignedAlloc(size_t size, std::align_val_t align)
+{
+    size_t alignment = static_cast<size_t>(align);
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+    void* ptr = std::aligned_alloc(alignment, rounded ? rounded : alignment);
+    if (!ptr)
+        throw std::bad_alloc();
+    charge(size);
+    return ptr;
+}
+
+void trackedFree(void* ptr)
+{
+    release(ptr);
+    std::free(ptr);
+}
+
+}  // namespace
+
+AllocScope::AllocScope(int tag, int fd) : _prevTag(g_tag), _prevFd(g_fd), _tag(tag)
+{
+    if (!g_atexitRegistered)
+    {
+        g_atexitRegistered = true;
+        std::atexit(reportAtExit);
+    }
+    g_tag = tag;
+    g_fd = fd;
+    _startAllocs = g_tags[tag].allocs;
+    _startBytes = g_tags[tag].bytes;
+}
+
+AllocScope::~AllocScope()
+{
+    g_tag = _prevTag;
+    g_fd = _prevFd;
+}
+
+void AllocScope::retag(int tag)
+{
+    Counters& from = g_tags[_tag];
+    Counters& to = g_tags[tag];
+    unsigned long long allocs = from.allocs - _startAllocs;
+    unsigned long long bytes = from.bytes - _startBytes;
+    from.allocs -= allocs;
+    from.bytes -= bytes;
+    to.allocs += allocs;
+    to.bytes += bytes;
+
+    _tag = tag;
+    _startAllocs = to.allocs;
+    _startBytes = to.bytes;
+    g_tag = tag;
+}
+
+void allocReport(std::ostream& out)
+{
+    // Snapshot first: building the report allocates too.
+    Counters tags[ALLOC_TAG_COUNT];
+    std::copy(g_tags, g_tags + ALLOC_TAG_COUNT, tags);
+
+    std::vector<std::pair<int, Counters> > conns;
+    for (int fd = 0; fd <= kMaxTrackedFd; ++fd)
+        if (g_conns[fd].allocs)
+            conns.push_back(std::make_pair(fd, g_conns[fd]));
+    std::sort(conns.begin(), conns.end(),
+              [](const std::pair<int, Counters>& a, const std::pair<int, Counters>& b)
+              { return a.second.bytes > b.second.bytes; });
+    if (conns.size() > kTopConnections)
+        conns.resize(kTopConnections);
+
+    char line[160];
+    out << "[ALLOC] report\n";
+    std::snprintf(line, sizeof(line), "%-12s %14s %16s %10s %14s\n", "tag", "allocs", "bytes",
+                  "avg_bytes", "frees");
+    out << line;
+    for (int tag = 0; tag < ALLOC_TAG_COUNT; ++tag)
+    {
+        const Counters& c = tags[tag];
+        if (!c.allocs && !c.frees)
+            continue;
+        std::snprintf(line, sizeof(line), "%-12s %14llu %16llu %10llu %14llu\n", tagName(tag),
+                      c.allocs, c.bytes, c.allocs ? c.bytes / c.allocs : 0, c.frees);
+        out << line;
+    }
+
+    out << "[ALLOC] top connections by bytes\n";
+    std::snprintf(line, sizeof(line), "%-12s %14s %16s %14s\n", "fd", "allocs", "bytes", "frees");
+    out << line;
+    for (const auto& entry : conns)
+    {
+        std::string fd = entry.first == kMaxTrackedFd ? ">=65536" : std::to_string(entry.first);
+        std::snprintf(line, sizeof(line), "%-12s %14llu %16llu %14llu\n", fd.c_str(),
+                      entry.second.allocs, entry.second.bytes, entry.second.frees);
+        out << line;
+    }
+    out.flush();
+}
+
+void allocRequestReport(int signum)
+{
+    (void)signum;
+    g_reportRequested = 1;
+}
+
+void allocPollReport()
+{
+    if (!g_reportRequested)
+        return;
+    g_reportRequested = 0;
+    allocReport(std::cerr);
+}
+
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return trackedAlloc(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+void* operator new(size_t size, std::align_val_t align) { return trackedAlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align)
+{
+    return trackedAlignedAlloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
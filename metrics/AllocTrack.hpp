@@ -0,0 +1,64 @@
+#pragma once
+
+/// Allocation accounting for the instrumented build (make ircserv_alloc).
+///
+/// AllocTrack.cpp replaces the global operator new/delete and charges every
+/// allocation to the current tag (the command being dispatched, or one of
+/// the pseudo tags below) and to the connection being served. A report with
+/// allocations and bytes per tag, and the heaviest connections, is printed
+/// on SIGUSR1 and at exit. Without IRC_ALLOC_TRACK the macros expand to
+/// nothing and the default allocator is used.
+
+#include "Metrics.hpp"
+
+enum AllocTag
+{
+    // 0 .. CMD_COUNT-1 are the CommandId values.
+    ALLOC_REGISTER = CMD_COUNT,  // PASS/NICK/USER before registration
+    ALLOC_PARSE,                 // line read but command not known yet
+    ALLOC_EVENT_LOOP,            // recv, framing and everything untagged
+    ALLOC_TAG_COUNT
+};
+
+#ifdef IRC_ALLOC_TRACK
+
+#include <ostream>
+
+class AllocScope
+{
+public:
+    AllocScope(int tag, int fd);
+    ~AllocScope();
+
+    /// Moves what was charged to the current tag inside this scope to tag,
+    /// and keeps charging tag from now on.
+    void retag(int tag);
+
+private:
+    int _prevTag;
+    int _prevFd;
+    int _tag;
+    unsigned long long _startAllocs;
+    unsigned long long _startBytes;
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+};
+
+void allocReport(std::ostream& out);
+/// Async-signal-safe: asks the event loop to print a report.
+void allocRequestReport(int signum);
+/// Prints a report if one was requested since the last call.
+void allocPollReport();
+
+#define ALLOC_SCOPE(tag, fd) AllocScope allocScope_((tag), (fd))
+#define ALLOC_RETAG(tag) allocScope_.retag(tag)
+#define ALLOC_POLL_REPORT() allocPollReport()
+
+#else
+
+#define ALLOC_SCOPE(tag, fd) ((void)0)
+#define ALLOC_RETAG(tag) ((void)0)
+#define ALLOC_POLL_REPORT() ((void)0)
+
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <time.h>
+
+#include <cstdint>
+
+/// Monotonic nanosecond timestamp for latency measurements.
+inline uint64_t monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
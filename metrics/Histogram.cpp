@@ -0,0 +1,79 @@
+#include "Histogram.hpp"
+
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() { reset(); }
+
+void LatencyHistogram::reset()
+{
+    for (size_t i = 0; i < kBucketCount; ++i) _buckets[i].store(0, std::memory_order_relaxed);
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+// Values below 2^kSubBucketBits map 1:1. Above that, the exponent selects a
+// block of kSubBuckets slots and the next kSubBucketBits bits below the
+// leading one select the slot inside the block.
+size_t LatencyHistogram::bucketIndex(uint64_t valueNs)
+{
+    if (valueNs < kSubBuckets)
+        return static_cast<size_t>(valueNs);
+
+    unsigned exponent = 63 - __builtin_clzll(valueNs);
+    if (exponent > kMaxExponent)
+        return kBucketCount - 1;
+
+    unsigned shift = exponent - kSubBucketBits;
+    size_t block = shift + 1;
+    size_t sub = static_cast<size_t>(valueNs >> shift) - kSubBuckets;
+    return block * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+    if (index < kSubBuckets)
+        return index;
+
+    size_t block = index >> kSubBucketBits;
+    size_t sub = index & (kSubBuckets - 1);
+    unsigned shift = static_cast<unsigned>(block - 1);
+    return ((uint64_t(kSubBuckets + sub) + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t valueNs)
+{
+    _buckets[bucketIndex(valueNs)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(valueNs, std::memory_order_relaxed);
+
+    uint64_t seen = _max.load(std::memory_order_relaxed);
+    while (valueNs > seen &&
+           !_max.compare_exchange_weak(seen, valueNs, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double q) const
+{
+    uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            uint64_t bound = bucketUpperBound(i);
+            uint64_t largest = max();
+            return bound < largest ? bound : largest;
+        }
+    }
+    return max();
+}
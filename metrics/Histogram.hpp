@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Log-linear (HDR-style) histogram of nanosecond durations.
+///
+/// Every power-of-two range is split into 2^kSubBucketBits linear
+/// sub-buckets, so any recorded value is reported with a relative error of
+/// at most 1 / 2^kSubBucketBits (about 3%). Values above 2^kMaxExponent ns
+/// (about 18 minutes) land in the last bucket.
+///
+/// Recording is a handful of relaxed atomic increments: no locks and no
+/// allocation, so it is safe to call from any hot path or thread.
+class LatencyHistogram
+{
+public:
+    static const unsigned kSubBucketBits = 5;
+    static const unsigned kMaxExponent = 40;
+    static const size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static const size_t kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    LatencyHistogram();
+
+    void record(uint64_t valueNs);
+    void reset();
+
+    uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+
+    /// Value at quantile q in [0, 1]; the upper edge of the bucket holding
+    /// the q-th sample, clamped to the largest recorded value. 0 when empty.
+    uint64_t percentile(double q) const;
+
+    static size_t bucketIndex(uint64_t valueNs);
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> _buckets[kBucketCount];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _max;
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// Estimates of heap memory held by server structures, exported on the admin
+/// endpoint as ircserv_memory_bytes. Node overheads follow the libstdc++
+/// layouts and ignore malloc's own per-chunk header, so the totals are a
+/// lower bound that is meant to be compared between builds, not with RSS.
+
+/// Heap bytes owned by s: 0 while it fits in the small-string buffer.
+inline size_t stringHeapBytes(const std::string& s)
+{
+    const char* data = s.data();
+    const char* self = reinterpret_cast<const char*>(&s);
+    if (data >= self && data < self + sizeof(s))
+        return 0;
+    return s.capacity() + 1;
+}
+
+/// std::list: prev and next pointers.
+const size_t kListNodeOverhead = 2 * sizeof(void*);
+/// std::unordered_map: next pointer (int keys do not cache their hash).
+const size_t kHashNodeOverhead = sizeof(void*);
+/// std::map: colour, parent, left and right.
+const size_t kTreeNodeOverhead = 4 * sizeof(void*);
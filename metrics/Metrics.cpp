@@ -0,0 +1,30 @@
+#include "Metrics.hpp"
+
+static const char* const kCommandNames[CMD_COUNT] = {
+    "NICK", "JOIN", "PART", "PRIVMSG", "NOTICE", "QUIT",
+    "MODE", "TOPIC", "KICK", "INVITE", "PING", "PONG", "UNKNOWN",
+};
+
+CommandId commandIdFor(const std::string& command)
+{
+    if (command == "MSG")
+        return CMD_PRIVMSG;
+    for (int id = 0; id < CMD_UNKNOWN; ++id)
+    {
+        if (command == kCommandNames[id])
+            return static_cast<CommandId>(id);
+    }
+    return CMD_UNKNOWN;
+}
+
+const char* commandName(CommandId id) { return kCommandNames[id]; }
+
+static const char* const kRegistrationFailureNames[REG_FAILURE_COUNT] = {
+    "timeout", "capacity",     "bad_password", "pass_required",
+    "invalid_params", "not_registered", "quit", "abandoned", "klined",
+};
+
+const char* registrationFailureName(RegistrationFailure reason)
+{
+    return kRegistrationFailureNames[reason];
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "Histogram.hpp"
+#include "TickProfiler.hpp"
+
+/// Commands with their own latency histogram. CMD_UNKNOWN collects every
+/// line that fell through to 421.
+enum CommandId
+{
+    CMD_NICK,
+    CMD_JOIN,
+    CMD_PART,
+    CMD_PRIVMSG,
+    CMD_NOTICE,
+    CMD_QUIT,
+    CMD_MODE,
+    CMD_TOPIC,
+    CMD_KICK,
+    CMD_INVITE,
+    CMD_PING,
+    CMD_PONG,
+    CMD_UNKNOWN,
+    CMD_COUNT
+};
+
+/// Maps an upper-cased command word to its id (MSG is an alias of PRIVMSG).
+CommandId commandIdFor(const std::string& command);
+const char* commandName(CommandId id);
+
+/// Why a connection failed to register, or a registration step was refused.
+enum RegistrationFailure
+{
+    REG_TIMEOUT,         // registration_timeout passed
+    REG_CAPACITY,        // max_unregistered reached; refused at accept
+    REG_BAD_PASSWORD,
+    REG_PASS_REQUIRED,   // NICK/USER before PASS
+    REG_INVALID_PARAMS,  // missing or malformed PASS/NICK/USER parameters
+    REG_NOT_REGISTERED,  // another command before registering (451)
+    REG_QUIT,            // QUIT before registering
+    REG_ABANDONED,       // peer closed before registering
+    REG_KLINED,          // matched a K-line when registration completed
+    REG_FAILURE_COUNT
+};
+
+const char* registrationFailureName(RegistrationFailure reason);
+
+/// Monotonic counters maintained by the server event loop.
+/// Gauges (current clients, channels, ...) are computed from live state when
+/// the metrics are rendered, so only cumulative values live here.
+struct ServerMetrics
+{
+    uint64_t connectionsAccepted = 0;
+    uint64_t connectionsClosed = 0;
+    uint64_t registrationsCompleted = 0;
+    uint64_t registrationFailures[REG_FAILURE_COUNT] = {};
+    uint64_t bytesReceived = 0;
+    uint64_t linesReceived = 0;
+    uint64_t commandsDispatched = 0;
+    uint64_t unknownCommands = 0;
+    uint64_t adminRequests = 0;
+
+    // Times a client stopped being read because of its output backlog.
+    uint64_t readPauses = 0;
+
+    // Lines held back because their command group was out of tokens, and
+    // times a connection used up its per-tick line budget.
+    uint64_t floodDeferred = 0;
+    uint64_t budgetDeferred = 0;
+
+    // Connections refused at accept by the per-address limits.
+    uint64_t ipLimitRefused = 0;
+    uint64_t connectThrottled = 0;
+    // Connections refused at accept by a D-line.
+    uint64_t dlineRefused = 0;
+
+    // PRIVMSG/NOTICE/TOPIC lines that failed UTF-8 validation (utf8_policy).
+    uint64_t utf8Rejected = 0;
+    uint64_t utf8Repaired = 0;
+
+    // Keepalive PINGs sent, and connections closed for not answering.
+    uint64_t pingsSent = 0;
+    uint64_t pingTimeouts = 0;
+
+    // Connections dropped with "Max SendQ exceeded" / "Excess Flood", per
+    // connection class.
+    std::map<std::string, uint64_t> sendQExceeded;
+    std::map<std::string, uint64_t> excessFlood;
+
+    // End-to-end dispatchCommand time per command, in nanoseconds.
+    LatencyHistogram commandLatency[CMD_COUNT];
+
+    // Event-loop tick statistics.
+    TickProfiler ticks;
+};
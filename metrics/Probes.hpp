@@ -0,0 +1,33 @@
+#pragma once
+
+/// USDT (SystemTap/DTrace-compatible) static probes, provider "ircserv".
+///
+/// With IRC_USDT defined the probes compile to a single nop plus an ELF note,
+/// so bpftrace/perf can attach to a running server; sys/sdt.h is header-only
+/// and adds no runtime dependency. Without it they compile to nothing.
+///
+///   client__accept(int fd, const char* ip)
+///   client__disconnect(int fd)
+///   client__registered(int fd, const char* nick)
+///   command__start(int fd, const char* command)
+///   command__done(int fd, const char* command, uint64_t elapsed_ns)
+///   channel__broadcast(const char* channel, size_t members, size_t bytes)
+///
+/// Example:
+///   bpftrace -e 'usdt:./ircserv:ircserv:channel__broadcast { @[arg1] = count(); }'
+
+#ifdef IRC_USDT
+
+#include <sys/sdt.h>
+
+#define IRC_PROBE1(name, a) DTRACE_PROBE1(ircserv, name, a)
+#define IRC_PROBE2(name, a, b) DTRACE_PROBE2(ircserv, name, a, b)
+#define IRC_PROBE3(name, a, b, c) DTRACE_PROBE3(ircserv, name, a, b, c)
+
+#else
+
+#define IRC_PROBE1(name, a) ((void)0)
+#define IRC_PROBE2(name, a, b) ((void)0)
+#define IRC_PROBE3(name, a, b, c) ((void)0)
+
+#endif
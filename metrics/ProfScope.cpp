@@ -0,0 +1,78 @@
+#include "ProfScope.hpp"
+
+#include <time.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static ProfSite* g_sites = nullptr;
+static volatile sig_atomic_t g_reportRequested = 0;
+
+// Reference points used to convert profTicks() into nanoseconds.
+static uint64_t g_startTicks = 0;
+static uint64_t g_startNs = 0;
+
+static uint64_t wallNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void reportAtExit() { profReport(std::cerr); }
+
+ProfSite::ProfSite(const char* siteName)
+    : name(siteName), calls(0), totalTicks(0), maxTicks(0), next(g_sites)
+{
+    if (!g_sites)
+    {
+        g_startTicks = profTicks();
+        g_startNs = wallNs();
+        std::atexit(reportAtExit);
+    }
+    g_sites = this;
+}
+
+void profReport(std::ostream& out)
+{
+    uint64_t elapsedNs = wallNs() - g_startNs;
+    uint64_t elapsedTicks = profTicks() - g_startTicks;
+    double nsPerTick = elapsedTicks ? static_cast<double>(elapsedNs) / elapsedTicks : 1.0;
+
+    std::vector<const ProfSite*> sites;
+    for (const ProfSite* site = g_sites; site; site = site->next) sites.push_back(site);
+    std::sort(sites.begin(), sites.end(), [](const ProfSite* a, const ProfSite* b)
+              { return a->totalTicks > b->totalTicks; });
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %12s %12s %10s %12s\n", "site", "calls",
+                  "total_ms", "avg_ns", "max_ns");
+    out << "[PROF] report\n" << line;
+    for (const ProfSite* site : sites)
+    {
+        double totalNs = site->totalTicks * nsPerTick;
+        std::snprintf(line, sizeof(line), "%-24s %12llu %12.3f %10.0f %12.0f\n", site->name,
+                      static_cast<unsigned long long>(site->calls), totalNs / 1e6,
+                      site->calls ? totalNs / site->calls : 0.0, site->maxTicks * nsPerTick);
+        out << line;
+    }
+    out.flush();
+}
+
+void profRequestReport(int signum)
+{
+    (void)signum;
+    g_reportRequested = 1;
+}
+
+void profPollReport()
+{
+    if (!g_reportRequested)
+        return;
+    g_reportRequested = 0;
+    profReport(std::cerr);
+}
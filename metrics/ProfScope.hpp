@@ -0,0 +1,82 @@
+#pragma once
+
+/// Scoped cycle counters for the instrumented build (make ircserv_prof).
+///
+/// PROF_SCOPE("name") times the enclosing scope and aggregates calls, total
+/// and maximum time per call site. Without IRC_PROFILE every macro expands
+/// to nothing, so the release ircserv contains no profiling code at all.
+
+#ifdef IRC_PROFILE
+
+#include <time.h>
+
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+struct ProfSite
+{
+    explicit ProfSite(const char* siteName);
+
+    const char* name;
+    uint64_t calls;
+    uint64_t totalTicks;
+    uint64_t maxTicks;
+    ProfSite* next;
+};
+
+inline uint64_t profTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+class ProfScope
+{
+public:
+    explicit ProfScope(ProfSite& site) : _site(site), _start(profTicks()) {}
+    ~ProfScope()
+    {
+        uint64_t elapsed = profTicks() - _start;
+        _site.calls++;
+        _site.totalTicks += elapsed;
+        if (elapsed > _site.maxTicks)
+            _site.maxTicks = elapsed;
+    }
+
+private:
+    ProfSite& _site;
+    uint64_t _start;
+
+    ProfScope(const ProfScope&) = delete;
+    ProfScope& operator=(const ProfScope&) = delete;
+};
+
+/// Prints every site sorted by total time.
+void profReport(std::ostream& out);
+/// Async-signal-safe: asks the event loop to print a report.
+void profRequestReport(int signum);
+/// Prints a report if one was requested since the last call.
+void profPollReport();
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+#define PROF_SCOPE(siteName)                                              \
+    static ProfSite PROF_CONCAT(profSite_, __LINE__)(siteName);           \
+    ProfScope PROF_CONCAT(profScope_, __LINE__)(PROF_CONCAT(profSite_, __LINE__))
+#define PROF_POLL_REPORT() profPollReport()
+
+#else
+
+#define PROF_SCOPE(siteName) ((void)0)
+#define PROF_POLL_REPORT() ((void)0)
+
+#endif
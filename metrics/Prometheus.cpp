@@ -0,0 +1,81 @@
+#include "Prometheus.hpp"
+
+#include <cstdio>
+
+#include "Histogram.hpp"
+
+namespace prom
+{
+
+void header(std::string& out, const std::string& name, const std::string& type,
+            const std::string& help)
+{
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+void sample(std::string& out, const std::string& name, uint64_t value)
+{
+    out += name + " " + std::to_string(value) + "\n";
+}
+
+void sample(std::string& out, const std::string& name, double value)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    out += name + " " + buf + "\n";
+}
+
+void sample(std::string& out, const std::string& name, const std::string& labels,
+            uint64_t value)
+{
+    out += name + "{" + labels + "} " + std::to_string(value) + "\n";
+}
+
+void sample(std::string& out, const std::string& name, const std::string& labels,
+            double value)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    out += name + "{" + labels + "} " + buf + "\n";
+}
+
+void counter(std::string& out, const std::string& name, const std::string& help, uint64_t value)
+{
+    header(out, name, "counter", help);
+    sample(out, name, value);
+}
+
+void gauge(std::string& out, const std::string& name, const std::string& help, uint64_t value)
+{
+    header(out, name, "gauge", help);
+    sample(out, name, value);
+}
+
+struct Quantile
+{
+    double value;
+    const char* label;
+};
+static const Quantile kQuantiles[] = {{0.5, "0.5"}, {0.99, "0.99"}, {0.999, "0.999"}};
+
+void summary(std::string& out, const std::string& name, const std::string& labels,
+             const LatencyHistogram& hist, double scale)
+{
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    for (const Quantile& q : kQuantiles)
+        sample(out, name, prefix + "quantile=\"" + q.label + "\"",
+               static_cast<double>(hist.percentile(q.value)) * scale);
+    if (labels.empty())
+    {
+        sample(out, name + "_sum", static_cast<double>(hist.sum()) * scale);
+        sample(out, name + "_count", hist.count());
+    }
+    else
+    {
+        sample(out, name + "_sum", labels, static_cast<double>(hist.sum()) * scale);
+        sample(out, name + "_count", labels, hist.count());
+    }
+}
+
+}  // namespace prom
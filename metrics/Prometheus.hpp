@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class LatencyHistogram;
+
+/// Minimal helpers producing the Prometheus text exposition format (0.0.4).
+/// Each metric family is emitted with its HELP and TYPE header followed by
+/// one or more samples.
+namespace prom
+{
+
+void header(std::string& out, const std::string& name, const std::string& type,
+            const std::string& help);
+
+void sample(std::string& out, const std::string& name, uint64_t value);
+void sample(std::string& out, const std::string& name, double value);
+void sample(std::string& out, const std::string& name, const std::string& labels,
+            uint64_t value);
+void sample(std::string& out, const std::string& name, const std::string& labels,
+            double value);
+
+/// Shorthand for a single unlabelled counter or gauge family.
+void counter(std::string& out, const std::string& name, const std::string& help, uint64_t value);
+void gauge(std::string& out, const std::string& name, const std::string& help, uint64_t value);
+
+/// Samples of a summary family (p50/p99/p999, _sum and _count) taken from a
+/// histogram. Values are multiplied by scale (1e-9 turns ns into seconds).
+/// The caller emits the family header once.
+void summary(std::string& out, const std::string& name, const std::string& labels,
+             const LatencyHistogram& hist, double scale);
+
+}  // namespace prom
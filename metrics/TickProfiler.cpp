@@ -0,0 +1,51 @@
+#include "TickProfiler.hpp"
+
+void TickProfiler::beginPoll(uint64_t nowNs)
+{
+    _current = Tick();
+    _pollStartNs = nowNs;
+}
+
+void TickProfiler::endPoll(uint64_t nowNs, int ready)
+{
+    _current.pollNs = nowNs - _pollStartNs;
+    _current.readyFds = ready > 0 ? static_cast<uint64_t>(ready) : 0;
+    _processStartNs = nowNs;
+}
+
+void TickProfiler::recordHandler(const char* command, int fd, uint64_t elapsedNs)
+{
+    _current.lines++;
+    if (elapsedNs > _current.maxHandlerNs)
+    {
+        _current.maxHandlerNs = elapsedNs;
+        _current.maxHandlerCommand = command;
+        _current.maxHandlerFd = fd;
+    }
+}
+
+const TickProfiler::Tick& TickProfiler::endTick(uint64_t nowNs)
+{
+    _current.processNs = nowNs - _processStartNs;
+    ++_ticks;
+
+    pollTime.record(_current.pollNs);
+    processTime.record(_current.processNs);
+    readyFds.record(_current.readyFds);
+    linesPerTick.record(_current.lines);
+    maxHandlerTime.record(_current.maxHandlerNs);
+    return _current;
+}
+
+std::string describeTick(const TickProfiler::Tick& tick)
+{
+    std::string msg = "process=" + std::to_string(tick.processNs / 1000) +
+                      "us poll=" + std::to_string(tick.pollNs / 1000) +
+                      "us ready_fds=" + std::to_string(tick.readyFds) +
+                      " lines=" + std::to_string(tick.lines);
+    if (tick.maxHandlerFd >= 0)
+        msg += " slowest=" + std::string(tick.maxHandlerCommand) + " fd=" +
+               std::to_string(tick.maxHandlerFd) + " " +
+               std::to_string(tick.maxHandlerNs / 1000) + "us";
+    return msg;
+}
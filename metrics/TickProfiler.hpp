@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Histogram.hpp"
+
+/// Per-iteration statistics of Server::run.
+///
+/// A tick is one poll() call plus the processing of every fd it reported.
+/// The profiler accumulates the current tick in place and folds it into
+/// cumulative histograms when the tick ends, so the hot path only touches a
+/// few integers.
+class TickProfiler
+{
+public:
+    struct Tick
+    {
+        uint64_t pollNs = 0;
+        uint64_t processNs = 0;
+        uint64_t readyFds = 0;
+        uint64_t lines = 0;
+        uint64_t maxHandlerNs = 0;
+        const char* maxHandlerCommand = "";
+        int maxHandlerFd = -1;
+    };
+
+    TickProfiler() = default;
+
+    void beginPoll(uint64_t nowNs);
+    void endPoll(uint64_t nowNs, int readyFds);
+    void recordHandler(const char* command, int fd, uint64_t elapsedNs);
+    /// Closes the tick and returns it; the result stays valid until the next
+    /// beginPoll().
+    const Tick& endTick(uint64_t nowNs);
+
+    uint64_t ticks() const { return _ticks; }
+    uint64_t slowTicks() const { return _slowTicks; }
+    void countSlowTick() { ++_slowTicks; }
+
+    // Cumulative distributions (durations in ns, counts as plain numbers).
+    LatencyHistogram pollTime;
+    LatencyHistogram processTime;
+    LatencyHistogram readyFds;
+    LatencyHistogram linesPerTick;
+    LatencyHistogram maxHandlerTime;
+
+private:
+    Tick _current;
+    uint64_t _pollStartNs = 0;
+    uint64_t _processStartNs = 0;
+    uint64_t _ticks = 0;
+    uint64_t _slowTicks = 0;
+};
+
+/// One-line human readable description used for slow tick warnings.
+std::string describeTick(const TickProfiler::Tick& tick);
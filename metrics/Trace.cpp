@@ -0,0 +1,99 @@
+#include "Trace.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+Tracer g_tracer;
+
+// Buffered events are written out once they exceed this size.
+static const size_t kFlushThreshold = 64 * 1024;
+
+Tracer::Tracer()
+    : _file(nullptr),
+      _sampleEvery(1),
+      _readCount(0),
+      _events(0),
+      _maxEvents(0),
+      _active(false),
+      _first(true),
+      _fd(-1),
+      _command("")
+{
+}
+
+Tracer::~Tracer() { close(); }
+
+void Tracer::open(const std::string& path, unsigned sampleEvery, uint64_t maxEvents)
+{
+    _file = std::fopen(path.c_str(), "w");
+    if (!_file)
+        throw std::runtime_error("Cannot open trace file: " + path);
+    _sampleEvery = sampleEvery ? sampleEvery : 1;
+    _maxEvents = maxEvents;
+    _buffer = "[\n";
+    std::cout << "[INFO] Tracing 1/" << _sampleEvery << " reads to " << path << std::endl;
+}
+
+void Tracer::flush()
+{
+    if (_file && !_buffer.empty())
+    {
+        std::fwrite(_buffer.data(), 1, _buffer.size(), _file);
+        _buffer.clear();
+    }
+}
+
+void Tracer::close()
+{
+    if (!_file)
+        return;
+    _buffer += "\n]\n";
+    flush();
+    std::fclose(_file);
+    _file = nullptr;
+    _active = false;
+}
+
+bool Tracer::beginSample(int fd)
+{
+    if (!_file || _events >= _maxEvents)
+        return false;
+    if (_readCount++ % _sampleEvery != 0)
+        return false;
+    _active = true;
+    _fd = fd;
+    _command = "";
+    return true;
+}
+
+void Tracer::endSample()
+{
+    _active = false;
+    _fd = -1;
+    if (_buffer.size() >= kFlushThreshold)
+        flush();
+    if (_file && _events >= _maxEvents)
+    {
+        std::cout << "[INFO] Trace event limit reached, closing trace" << std::endl;
+        close();
+    }
+}
+
+void Tracer::complete(const char* name, uint64_t startNs, uint64_t endNs, int fd, long peer)
+{
+    if (!_file || _events >= _maxEvents)
+        return;
+    ++_events;
+
+    char event[256];
+    int len = std::snprintf(event, sizeof(event),
+                            "%s{\"name\":\"%s\",\"cat\":\"irc\",\"ph\":\"X\",\"ts\":%.3f,"
+                            "\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"cmd\":\"%s\"",
+                            _first ? "" : ",\n", name, startNs / 1000.0,
+                            (endNs - startNs) / 1000.0, fd, _command);
+    _first = false;
+    _buffer.append(event, len);
+    if (peer >= 0)
+        _buffer += ",\"peer\":" + std::to_string(peer);
+    _buffer += "}}";
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Clock.hpp"
+
+/// Opt-in recorder of per-message processing spans in Chrome trace-event
+/// JSON (load the file in chrome://tracing or Perfetto).
+///
+/// Sampling happens per socket read: one read in `sampleEvery` is traced
+/// together with everything it triggers (framing, parsing, dispatch, the
+/// handler and each fan-out send). Each client fd gets its own track.
+/// Recording stops by itself after `maxEvents` so a trace can be left on
+/// for a while on a busy server.
+class Tracer
+{
+public:
+    Tracer();
+    ~Tracer();
+
+    /// Starts writing to path. Throws std::runtime_error if it cannot be opened.
+    void open(const std::string& path, unsigned sampleEvery, uint64_t maxEvents);
+    /// Writes the remaining events and terminates the JSON array.
+    void close();
+
+    /// Decides whether the read on fd is sampled; returns true if so.
+    bool beginSample(int fd);
+    void endSample();
+    bool active() const { return _active; }
+
+    /// Command currently being handled, attached to nested spans.
+    void setCommand(const char* command) { _command = command; }
+
+    /// Records a complete ("X") event. peer >= 0 is emitted as args.peer.
+    void complete(const char* name, uint64_t startNs, uint64_t endNs, int fd, long peer = -1);
+
+    int currentFd() const { return _fd; }
+
+private:
+    FILE* _file;
+    std::string _buffer;
+    unsigned _sampleEvery;
+    uint64_t _readCount;
+    uint64_t _events;
+    uint64_t _maxEvents;
+    bool _active;
+    bool _first;
+    int _fd;
+    const char* _command;
+
+    void flush();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+};
+
+extern Tracer g_tracer;
+
+/// RAII sampling decision for one socket read.
+class TraceSample
+{
+public:
+    explicit TraceSample(int fd) : _sampled(g_tracer.beginSample(fd)) {}
+    ~TraceSample()
+    {
+        if (_sampled)
+            g_tracer.endSample();
+    }
+
+private:
+    bool _sampled;
+
+    TraceSample(const TraceSample&) = delete;
+    TraceSample& operator=(const TraceSample&) = delete;
+};
+
+/// RAII span: records [construction, destruction) when the current read is
+/// sampled, costs a single branch otherwise.
+class TraceSpan
+{
+public:
+    TraceSpan(const char* name, int fd, long peer = -1)
+        : _name(name), _fd(fd), _peer(peer), _start(g_tracer.active() ? monotonicNs() : 0)
+    {
+    }
+    ~TraceSpan()
+    {
+        if (_start && g_tracer.active())
+            g_tracer.complete(_name, _start, monotonicNs(), _fd, _peer);
+    }
+
+private:
+    const char* _name;
+    int _fd;
+    long _peer;
+    uint64_t _start;
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
@@ -0,0 +1,250 @@
+#include "MaskList.hpp"
+
+#include <algorithm>
+
+#include "metrics/MemoryUsage.hpp"
+#include "utils.hpp"
+
+static bool hasWildcard(const std::string& s) { return s.find_first_of("*?") != std::string::npos; }
+
+static std::string orAny(const std::string& part) { return part.empty() ? "*" : part; }
+
+bool wildcardMatch(const std::string& pattern, const std::string& text)
+{
+    // Greedy scan that backtracks only to the last '*': linear for the
+    // usual masks, pattern length times text length at worst.
+    size_t p = 0, t = 0;
+    size_t star = std::string::npos, mark = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t]))
+        {
+            ++p;
+            ++t;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            mark = t;
+        }
+        else if (star != std::string::npos)
+        {
+            p = star + 1;
+            t = ++mark;
+        }
+        else
+            return false;
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+std::string MaskList::canonical(const std::string& mask)
+{
+    size_t bang = mask.find('!');
+    size_t at = mask.find('@', bang == std::string::npos ? 0 : bang);
+    if (bang == std::string::npos && at == std::string::npos)
+    {
+        if (mask.find_first_of(".:") != std::string::npos)
+            return "*!*@" + mask;
+        return orAny(mask) + "!*@*";
+    }
+    if (bang == std::string::npos)
+        return "*!" + orAny(mask.substr(0, at)) + "@" + orAny(mask.substr(at + 1));
+    if (at == std::string::npos)
+        return orAny(mask.substr(0, bang)) + "!" + orAny(mask.substr(bang + 1)) + "@*";
+    return orAny(mask.substr(0, bang)) + "!" + orAny(mask.substr(bang + 1, at - bang - 1)) + "@" +
+           orAny(mask.substr(at + 1));
+}
+
+bool MaskList::add(const std::string& mask, const std::string& setBy, time_t setAt)
+{
+    std::string folded = ircCaseFold(mask);
+    if (_ids.count(folded))
+        return false;
+
+    size_t bang = folded.find('!');
+    size_t at = folded.find('@', bang);
+    uint32_t id = static_cast<uint32_t>(_entries.size());
+    _entries.push_back(Entry{mask, setBy, setAt});
+    _compiled.push_back(Compiled{folded.substr(0, bang), folded.substr(bang + 1, at - bang - 1),
+                                 folded.substr(at + 1)});
+    _ids.emplace(folded, id);
+    index(id);
+    return true;
+}
+
+bool MaskList::remove(const std::string& mask)
+{
+    std::unordered_map<std::string, uint32_t>::iterator it = _ids.find(ircCaseFold(mask));
+    if (it == _ids.end())
+        return false;
+    uint32_t removed = it->second;
+    _entries.erase(_entries.begin() + removed);
+    _compiled.erase(_compiled.begin() + removed);
+
+    // Removal is rare next to lookups, so ids stay dense and the index is
+    // simply rebuilt.
+    _ids.clear();
+    _byHost.clear();
+    _hostPrefixes.nodes.clear();
+    _hostSuffixes.nodes.clear();
+    _byNick.clear();
+    _rest.clear();
+    for (uint32_t id = 0; id < _compiled.size(); ++id)
+    {
+        const Compiled& c = _compiled[id];
+        _ids.emplace(c.nick + "!" + c.user + "@" + c.host, id);
+        index(id);
+    }
+    return true;
+}
+
+void MaskList::index(uint32_t id)
+{
+    const Compiled& c = _compiled[id];
+    size_t first = c.host.find_first_of("*?");
+    if (first == std::string::npos)
+    {
+        _byHost[c.host].push_back(id);
+        return;
+    }
+    if (first > 0)
+    {
+        _hostPrefixes.insert(c.host.substr(0, first), id);
+        return;
+    }
+    size_t last = c.host.find_last_of("*?");
+    if (last + 1 < c.host.size())
+    {
+        std::string suffix = c.host.substr(last + 1);
+        std::reverse(suffix.begin(), suffix.end());
+        _hostSuffixes.insert(suffix, id);
+        return;
+    }
+    if (!hasWildcard(c.nick))
+        _byNick[c.nick].push_back(id);
+    else
+        _rest.push_back(id);
+}
+
+void MaskList::Trie::insert(const std::string& key, uint32_t id)
+{
+    if (nodes.empty())
+        nodes.emplace_back();
+    uint32_t node = 0;
+    for (char ch : key)
+    {
+        uint32_t next = 0;
+        for (const std::pair<char, uint32_t>& child : nodes[node].children)
+        {
+            if (child.first == ch)
+            {
+                next = child.second;
+                break;
+            }
+        }
+        if (next == 0)
+        {
+            next = static_cast<uint32_t>(nodes.size());
+            nodes[node].children.emplace_back(ch, next);
+            nodes.emplace_back();
+        }
+        node = next;
+    }
+    nodes[node].masks.push_back(id);
+}
+
+bool MaskList::matchesAny(const std::vector<uint32_t>& ids, const std::string& nick,
+                          const std::string& user, const std::string& host) const
+{
+    for (uint32_t id : ids)
+    {
+        const Compiled& c = _compiled[id];
+        if (wildcardMatch(c.host, host) && wildcardMatch(c.user, user) &&
+            wildcardMatch(c.nick, nick))
+            return true;
+    }
+    return false;
+}
+
+bool MaskList::matchesAlong(const Trie& trie, const std::string& host, bool reversed,
+                            const std::string& nick, const std::string& user) const
+{
+    if (trie.nodes.empty())
+        return false;
+    uint32_t node = 0;
+    for (size_t i = 0; i < host.size(); ++i)
+    {
+        char ch = reversed ? host[host.size() - 1 - i] : host[i];
+        uint32_t next = 0;
+        for (const std::pair<char, uint32_t>& child : trie.nodes[node].children)
+        {
+            if (child.first == ch)
+            {
+                next = child.second;
+                break;
+            }
+        }
+        if (next == 0)
+            return false;
+        node = next;
+        if (matchesAny(trie.nodes[node].masks, nick, user, host))
+            return true;
+    }
+    return false;
+}
+
+bool MaskList::matches(const std::string& nick, const std::string& user,
+                       const std::string& host) const
+{
+    if (_entries.empty())
+        return false;
+
+    std::unordered_map<std::string, std::vector<uint32_t>>::const_iterator exact =
+        _byHost.find(host);
+    if (exact != _byHost.end() && matchesAny(exact->second, nick, user, host))
+        return true;
+    if (matchesAlong(_hostPrefixes, host, false, nick, user) ||
+        matchesAlong(_hostSuffixes, host, true, nick, user))
+        return true;
+    std::unordered_map<std::string, std::vector<uint32_t>>::const_iterator byNick =
+        _byNick.find(nick);
+    if (byNick != _byNick.end() && matchesAny(byNick->second, nick, user, host))
+        return true;
+    return matchesAny(_rest, nick, user, host);
+}
+
+size_t MaskList::Trie::heapBytes() const
+{
+    size_t bytes = nodes.capacity() * sizeof(TrieNode);
+    for (const TrieNode& node : nodes)
+        bytes += node.children.capacity() * sizeof(node.children[0]) +
+                 node.masks.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+static size_t bucketBytes(const std::unordered_map<std::string, std::vector<uint32_t>>& map)
+{
+    size_t bytes = map.bucket_count() * sizeof(void*);
+    for (const auto& entry : map)
+        bytes += kHashNodeOverhead + sizeof(entry) + stringHeapBytes(entry.first) +
+                 entry.second.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+size_t MaskList::heapBytes() const
+{
+    size_t bytes = _entries.capacity() * sizeof(Entry) + _compiled.capacity() * sizeof(Compiled);
+    for (size_t i = 0; i < _entries.size(); ++i)
+        bytes += stringHeapBytes(_entries[i].mask) + stringHeapBytes(_entries[i].setBy) +
+                 stringHeapBytes(_compiled[i].nick) + stringHeapBytes(_compiled[i].user) +
+                 stringHeapBytes(_compiled[i].host);
+    bytes += _ids.bucket_count() * sizeof(void*);
+    for (const auto& entry : _ids)
+        bytes += kHashNodeOverhead + sizeof(entry) + stringHeapBytes(entry.first);
+    bytes += bucketBytes(_byHost) + bucketBytes(_byNick);
+    bytes += _hostPrefixes.heapBytes() + _hostSuffixes.heapBytes();
+    bytes += _rest.capacity() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// One channel list mode (+b, +e or +I): nick!user@host masks with '*' and
+/// '?' wildcards, matched part by part against a member's nick, user and
+/// host.
+///
+/// Masks are compiled into an index when they are set, keyed on their host
+/// part. A literal host goes in a hash map, a host with a literal prefix
+/// ("10.0.*") in a prefix trie, and a host with only a literal suffix
+/// ("*.isp.net") in a trie over the reversed suffix. Masks whose host has
+/// wildcards at both ends are indexed by a literal nick when they have one;
+/// only the rest ("*!*@*", "guest*!*@*") are tried one by one. A lookup
+/// walks each trie once along the subject's host and wildcard-matches only
+/// the masks whose literal part already agrees, so its cost follows the
+/// host length and the few candidates rather than the size of the list.
+class MaskList
+{
+public:
+    struct Entry
+    {
+        std::string mask;  // canonical nick!user@host, as it was set
+        std::string setBy;
+        time_t setAt;
+    };
+
+    /// Completes a partial mask to the stored form: "nick" becomes
+    /// "nick!*@*", "user@host" "*!user@host", "nick!user" "nick!user@*" and
+    /// a bare name containing '.' or ':' "*!*@name".
+    static std::string canonical(const std::string& mask);
+
+    /// Adds a canonical mask. False if it is already set (ignoring case).
+    bool add(const std::string& mask, const std::string& setBy, time_t setAt);
+    /// False if the mask was not set. Rebuilds the index.
+    bool remove(const std::string& mask);
+
+    /// True if a mask matches. The arguments must be ircCaseFold()ed.
+    bool matches(const std::string& nick, const std::string& user,
+                 const std::string& host) const;
+
+    const std::vector<Entry>& entries() const { return _entries; }
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+    /// Estimated heap bytes (see metrics/MemoryUsage.hpp).
+    size_t heapBytes() const;
+
+private:
+    // A mask split into its case-folded parts.
+    struct Compiled
+    {
+        std::string nick;
+        std::string user;
+        std::string host;
+    };
+
+    // Children are searched linearly: host names use few distinct characters
+    // at any one position.
+    struct TrieNode
+    {
+        std::vector<std::pair<char, uint32_t>> children;
+        std::vector<uint32_t> masks;  // masks whose literal ends here
+    };
+
+    struct Trie
+    {
+        std::vector<TrieNode> nodes;
+
+        void insert(const std::string& key, uint32_t id);
+        size_t heapBytes() const;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<Compiled> _compiled;  // parallel to _entries
+    std::unordered_map<std::string, uint32_t> _ids;  // folded mask -> index
+
+    std::unordered_map<std::string, std::vector<uint32_t>> _byHost;
+    Trie _hostPrefixes;
+    Trie _hostSuffixes;  // keys reversed
+    std::unordered_map<std::string, std::vector<uint32_t>> _byNick;
+    std::vector<uint32_t> _rest;
+
+    void index(uint32_t id);
+    bool matchesAny(const std::vector<uint32_t>& ids, const std::string& nick,
+                    const std::string& user, const std::string& host) const;
+    bool matchesAlong(const Trie& trie, const std::string& host, bool reversed,
+                      const std::string& nick, const std::string& user) const;
+};
+
+/// '*' matches any run of characters, '?' any one character.
+bool wildcardMatch(const std::string& pattern, const std::string& text);
@@ -1,104 +1,148 @@
 #include "ModeHandler.hpp"
 
+#include <climits>
+#include <cstdlib>
+#include <ctime>
+
 #include "ModeUtils.hpp"
 #include "utils.hpp"
 
-bool handleInviteOnlyMode(Client* client, Channel& channel, bool adding) {
+void ModeChanges::add(bool adding, char mode, const std::string& param) {
+    char sign = adding ? '+' : '-';
+    if (sign != _sign) {
+        _modes += sign;
+        _sign = sign;
+    }
+    _modes += mode;
+    if (!param.empty())
+        _params += " " + param;
+}
+
+std::string ModeChanges::line(const std::string& prefix,
+                              const std::string& channel) const {
+    return ":" + prefix + " MODE " + channel + " " + _modes + _params + "\r\n";
+}
+
+void handleInviteOnlyMode(Channel& channel, bool adding, ModeChanges& changes) {
+    if (adding == channel.isInviteOnly())
+        return;
     channel.setInviteOnly(adding);
-    std::string msg = ":" + client->getNick() + "!~" + client->getUser() + "@" +
-                      client->getIPa() + " MODE " + channel.getName() + " " +
-                      (adding ? "+i" : "-i") + "\r\n";
-    channel.broadcast(msg);
-    return true;
+    changes.add(adding, 'i');
 }
 
-bool handleTopicRestrictMode(Client* client, Channel& channel, bool adding) {
+void handleTopicRestrictMode(Channel& channel, bool adding,
+                             ModeChanges& changes) {
     if (adding == channel.isTopicRestricted())
-        return true;
+        return;
     channel.setTopicRestricted(adding);
-    std::string msg = ":" + client->getNick() + "!~" + client->getUser() + "@" +
-                      client->getIPa() + " MODE " + channel.getName() + " " +
-                      (adding ? "+t" : "-t") + "\r\n";
-    channel.broadcast(msg);
-    return true;
+    changes.add(adding, 't');
 }
 
-bool handleKeyMode(Client* client, Channel& channel, bool adding,
-                   const std::vector<std::string>& params) {
+void handleKeyMode(Client* client, Channel& channel, bool adding,
+                   const std::string* param, ModeChanges& changes) {
     if (adding) {
-        if (params.size() < 4) {
+        if (!param) {
             sendError(client->getFd(), "461", client->getNick(),
                       "MODE :Not enough parameters");
-            return true;
+            return;
         }
-        const std::string& key = params[3];
-        if (!isValidKey(key)) {
+        if (!isValidKey(*param)) {
             sendError(client->getFd(), "525", client->getNick(),
                       channel.getName() + " :Key is not well-formed");
-            return true;
+            return;
         }
-        channel.setKey(key);
+        if (*param == channel.getModeKey())
+            return;
+        channel.setKey(*param);
+        changes.add(true, 'k', *param);
     } else {
+        if (!channel.isKeyed())
+            return;
         channel.setKey("");
+        changes.add(false, 'k');
     }
-    std::string msg = ":" + client->getNick() + "!~" + client->getUser() + "@" +
-                      client->getIPa() + " MODE " + channel.getName() + " " +
-                      (adding ? "+k " + params[3] : "-k") + "\r\n";
-    channel.broadcast(msg);
-    return true;
 }
 
-bool handleLimitMode(Client* client, Channel& channel, bool adding,
-                     const std::vector<std::string>& params) {
-    if (adding) {
-        if (params.size() < 4) {
-            sendError(client->getFd(), "461", client->getNick(),
-                      "MODE :Not enough parameters");
-            return true;
-        }
-        int limit = std::stoi(params[3]);
-        channel.setClientLimit(limit);
-    } else {
+void handleLimitMode(Client* client, Channel& channel, bool adding,
+                     const std::string* param, ModeChanges& changes) {
+    if (!adding) {
+        if (channel.getClientLimit() == -1)
+            return;
         channel.setClientLimit(-1);
+        changes.add(false, 'l');
+        return;
     }
-    std::string msg = ":" + client->getNick() + "!~" + client->getUser() + "@" +
-                      client->getIPa() + " MODE " + channel.getName() + " " +
-                      (adding ? "+l " + params[3] : "-l") + "\r\n";
-    channel.broadcast(msg);
-    return true;
+    if (!param) {
+        sendError(client->getFd(), "461", client->getNick(),
+                  "MODE :Not enough parameters");
+        return;
+    }
+    // Anything but a positive number is ignored, as other servers do.
+    char* end = nullptr;
+    long limit = std::strtol(param->c_str(), &end, 10);
+    if (param->empty() || *end != '\0' || limit <= 0 || limit > INT_MAX)
+        return;
+    if (limit == channel.getClientLimit())
+        return;
+    channel.setClientLimit(static_cast<int>(limit));
+    changes.add(true, 'l', std::to_string(limit));
 }
 
-bool handleOpMode(Server& server, Client* client, Channel& channel, bool adding,
-                  const std::vector<std::string>& params) {
-    if (params.size() < 4) {
+void handleOpMode(Server& server, Client* client, Channel& channel, bool adding,
+                  const std::string* param, ModeChanges& changes) {
+    if (!param) {
         sendError(client->getFd(), "461", client->getNick(),
                   "MODE :Not enough parameters");
-        return true;
+        return;
     }
 
-    std::string targetNick = params[3];
+    const std::string& targetNick = *param;
     Client* target = server.getClientObjByNick(targetNick);
     if (!target) {
         sendError(client->getFd(), "401", client->getNick(),
                   targetNick + " :No such nick/channel");
-        return true;
+        return;
     }
 
     if (!channel.isInChannel(target)) {
         sendError(client->getFd(), "441", client->getNick(),
                   targetNick + " " + channel.getName() +
                       " :They aren't on that channel");
-        return true;
+        return;
     }
 
+    if (adding == channel.isOperator(target))
+        return;
     if (adding)
         channel.addOp(target->getFd());
     else
         channel.removeOp(target->getFd());
+    changes.add(adding, 'o', targetNick);
+}
 
-    std::string msg = ":" + client->getNick() + "!~" + client->getUser() + "@" +
-                      client->getIPa() + " MODE " + channel.getName() + " " +
-                      (adding ? "+o " : "-o ") + targetNick + "\r\n";
-    channel.broadcast(msg);
-    return true;
+void handleListMode(Server& server, Client* client, Channel& channel, char mode,
+                    bool adding, const std::string* param,
+                    ModeChanges& changes) {
+    if (!param) {
+        returnMaskList(server, client->getFd(), channel, mode);
+        return;
+    }
+
+    MaskList& list = channel.maskList(mode);
+    std::string mask = MaskList::canonical(*param);
+    if (adding) {
+        if (list.size() >= server.getConfig().maxListEntries) {
+            sendError(client->getFd(), "478", client->getNick(),
+                      channel.getName() + " " + std::string(1, mode) +
+                          " :Channel list is full");
+            return;
+        }
+        std::string setBy = client->getNick() + "!~" + client->getUser() +
+                            "@" + client->getIPa();
+        if (!list.add(mask, setBy, std::time(nullptr)))
+            return;
+    } else if (!list.remove(mask)) {
+        return;
+    }
+    changes.add(adding, mode, mask);
 }
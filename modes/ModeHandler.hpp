@@ -6,11 +6,33 @@
 #include "Client.hpp"
 #include "Server.hpp"
 
-bool handleInviteOnlyMode(Client* client, Channel& channel, bool adding);
-bool handleTopicRestrictMode(Client* client, Channel& channel, bool adding);
-bool handleKeyMode(Client* client, Channel& channel, bool adding,
-                   const std::vector<std::string>& params);
-bool handleLimitMode(Client* client, Channel& channel, bool adding,
-                     const std::vector<std::string>& params);
-bool handleOpMode(Server& server, Client* client, Channel& channel, bool adding,
-                  const std::vector<std::string>& params);
+// The changes one MODE command made, in order, announced to the channel as
+// a single MODE line ("+ik-o key nick").
+class ModeChanges {
+public:
+    void add(bool adding, char mode, const std::string& param = "");
+    bool empty() const { return _modes.empty(); }
+    // ":<prefix> MODE <channel> <modes>[ <params>]\r\n"
+    std::string line(const std::string& prefix,
+                     const std::string& channel) const;
+
+private:
+    std::string _modes;
+    std::string _params;
+    char _sign = 0;
+};
+
+// Each handler applies one mode letter with its parameter (nullptr when the
+// mode string ran out of them), and records the change if one was made.
+void handleInviteOnlyMode(Channel& channel, bool adding, ModeChanges& changes);
+void handleTopicRestrictMode(Channel& channel, bool adding,
+                             ModeChanges& changes);
+void handleKeyMode(Client* client, Channel& channel, bool adding,
+                   const std::string* param, ModeChanges& changes);
+void handleLimitMode(Client* client, Channel& channel, bool adding,
+                     const std::string* param, ModeChanges& changes);
+void handleOpMode(Server& server, Client* client, Channel& channel, bool adding,
+                  const std::string* param, ModeChanges& changes);
+void handleListMode(Server& server, Client* client, Channel& channel, char mode,
+                    bool adding, const std::string* param,
+                    ModeChanges& changes);
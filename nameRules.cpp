@@ -0,0 +1,95 @@
+#include "nameRules.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace
+{
+
+enum : uint8_t
+{
+    NICK_FIRST = 1 << 0,  // may start a nickname
+    NICK_REST = 1 << 1,   // may follow the first character
+    USER_CHAR = 1 << 2,
+};
+
+constexpr bool isSpecial(unsigned c)
+{
+    return (c >= 0x5B && c <= 0x60) || (c >= 0x7B && c <= 0x7D);
+}
+
+constexpr std::array<uint8_t, 256> buildClasses()
+{
+    std::array<uint8_t, 256> classes = {};
+    for (unsigned c = 0; c < 256; ++c)
+    {
+        bool letter = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+        bool digit = c >= '0' && c <= '9';
+        uint8_t bits = 0;
+        if (letter || isSpecial(c))
+            bits |= NICK_FIRST | NICK_REST;
+        if (digit || c == '-')
+            bits |= NICK_REST;
+        if (c != 0 && c != '\r' && c != '\n' && c != ' ' && c != '@')
+            bits |= USER_CHAR;
+        classes[c] = bits;
+    }
+    return classes;
+}
+
+constexpr std::array<uint8_t, 256> kClasses = buildClasses();
+
+static_assert(kClasses['{'] & NICK_FIRST, "special characters may start a nick");
+static_assert(!(kClasses['7'] & NICK_FIRST) && (kClasses['7'] & NICK_REST),
+              "digits may not start a nick");
+static_assert(!(kClasses['@'] & USER_CHAR), "'@' separates user from host");
+
+inline uint8_t classOf(char c) { return kClasses[static_cast<unsigned char>(c)]; }
+
+}  // namespace
+
+NameCheck checkNick(const std::string& nick, size_t maxLength)
+{
+    if (nick.empty())
+        return NAME_EMPTY;
+    if (nick.size() > maxLength)
+        return NAME_TOO_LONG;
+    if (!(classOf(nick[0]) & NICK_FIRST))
+        return NAME_BAD_FIRST;
+    for (size_t i = 1; i < nick.size(); ++i)
+    {
+        if (!(classOf(nick[i]) & NICK_REST))
+            return NAME_BAD_CHAR;
+    }
+    return NAME_OK;
+}
+
+NameCheck checkUser(const std::string& user)
+{
+    if (user.empty())
+        return NAME_EMPTY;
+    for (char c : user)
+    {
+        if (!(classOf(c) & USER_CHAR))
+            return NAME_BAD_CHAR;
+    }
+    return NAME_OK;
+}
+
+const char* nameCheckReason(NameCheck check)
+{
+    switch (check)
+    {
+        case NAME_OK:
+            return "valid";
+        case NAME_EMPTY:
+            return "empty";
+        case NAME_TOO_LONG:
+            return "too long";
+        case NAME_BAD_FIRST:
+            return "must start with a letter or one of []\\`_^{|}";
+        case NAME_BAD_CHAR:
+            return "invalid character";
+    }
+    return "invalid";
+}
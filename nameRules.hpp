@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// Nickname and username rules (RFC 2812, section 2.3.1), shared by
+/// registration and NICK. Each check is one pass over the name against a
+/// 256-entry character-class table built at compile time.
+///
+///   nickname = ( letter / special ) *( letter / digit / special / "-" )
+///   special  = "[" / "]" / "\" / "`" / "_" / "^" / "{" / "|" / "}"
+///   user     = 1*( any octet except NUL, CR, LF, space and "@" )
+enum NameCheck
+{
+    NAME_OK,
+    NAME_EMPTY,
+    NAME_TOO_LONG,
+    NAME_BAD_FIRST,  // nick starts with a digit or "-"
+    NAME_BAD_CHAR,
+};
+
+/// Checks nick against the nickname grammar and maxLength (NICKLEN).
+NameCheck checkNick(const std::string& nick, size_t maxLength);
+NameCheck checkUser(const std::string& user);
+
+/// Short reason for a failed check, for 432 replies and logs.
+const char* nameCheckReason(NameCheck check);
@@ -0,0 +1,120 @@
+#include "CidrTree.hpp"
+
+#include <algorithm>
+
+static uint32_t prefixMask(int bits) { return bits == 0 ? 0 : 0xffffffffu << (32 - bits); }
+
+// Bit pos of addr, counting from the most significant.
+static unsigned bitAt(uint32_t addr, int pos) { return (addr >> (31 - pos)) & 1; }
+
+CidrTree::CidrTree() : _size(0) { addNode(0, 0, false); }
+
+uint32_t CidrTree::addNode(uint32_t prefix, int bits, bool stored)
+{
+    _nodes.push_back(Node{prefix, static_cast<uint8_t>(bits), stored, {0, 0}});
+    return static_cast<uint32_t>(_nodes.size() - 1);
+}
+
+bool CidrTree::insert(uint32_t network, int bits)
+{
+    uint32_t node = 0;
+    for (;;)
+    {
+        if (_nodes[node].bits == bits)
+        {
+            if (_nodes[node].stored)
+                return false;
+            _nodes[node].stored = true;
+            ++_size;
+            return true;
+        }
+
+        unsigned side = bitAt(network, _nodes[node].bits);
+        uint32_t child = _nodes[node].child[side];
+        if (child == 0)
+        {
+            uint32_t leaf = addNode(network, bits, true);
+            _nodes[node].child[side] = leaf;
+            ++_size;
+            return true;
+        }
+
+        // Length of the prefix shared with the child, up to either length.
+        const Node& next = _nodes[child];
+        uint32_t diff = network ^ next.prefix;
+        int common = diff == 0 ? 32 : __builtin_clz(diff);
+        common = std::min(common, std::min(bits, static_cast<int>(next.bits)));
+        if (common == next.bits)
+        {
+            node = child;
+            continue;
+        }
+
+        // The new prefix branches off above the child: put a node for the
+        // shared part in between, which is the new prefix itself when it is
+        // the shorter one.
+        uint32_t split = addNode(network & prefixMask(common), common, common == bits);
+        _nodes[split].child[bitAt(_nodes[child].prefix, common)] = child;
+        if (common < bits)
+        {
+            uint32_t leaf = addNode(network, bits, true);
+            _nodes[split].child[bitAt(network, common)] = leaf;
+        }
+        _nodes[node].child[side] = split;
+        ++_size;
+        return true;
+    }
+}
+
+bool CidrTree::erase(uint32_t network, int bits)
+{
+    std::vector<std::pair<uint32_t, int>> kept = prefixes();
+    std::vector<std::pair<uint32_t, int>>::iterator found =
+        std::find(kept.begin(), kept.end(), std::make_pair(network, bits));
+    if (found == kept.end())
+        return false;
+    kept.erase(found);
+
+    // Erasing is rare next to lookups: rebuild rather than merge nodes.
+    _nodes.clear();
+    _size = 0;
+    addNode(0, 0, false);
+    for (const std::pair<uint32_t, int>& prefix : kept) insert(prefix.first, prefix.second);
+    return true;
+}
+
+bool CidrTree::contains(uint32_t addr) const
+{
+    uint32_t node = 0;
+    for (;;)
+    {
+        const Node& current = _nodes[node];
+        if ((addr & prefixMask(current.bits)) != current.prefix)
+            return false;
+        if (current.stored)
+            return true;
+        if (current.bits == 32)
+            return false;
+        node = current.child[bitAt(addr, current.bits)];
+        if (node == 0)
+            return false;
+    }
+}
+
+void CidrTree::collect(uint32_t node, std::vector<std::pair<uint32_t, int>>& out) const
+{
+    const Node& current = _nodes[node];
+    if (current.stored)
+        out.push_back(std::make_pair(current.prefix, static_cast<int>(current.bits)));
+    for (uint32_t child : current.child)
+        if (child != 0)
+            collect(child, out);
+}
+
+std::vector<std::pair<uint32_t, int>> CidrTree::prefixes() const
+{
+    std::vector<std::pair<uint32_t, int>> out;
+    out.reserve(_size);
+    collect(0, out);
+    return out;
+}
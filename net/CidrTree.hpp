@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// A set of IPv4 prefixes (host byte order) answering "is this address in
+/// any of them?".
+///
+/// The prefixes live in a path-compressed binary radix tree: every node
+/// holds a prefix, and its two children extend it with a 0 or a 1 bit at
+/// the first position where their subtrees differ. A node exists only for a
+/// stored prefix or where two branches split, so n prefixes take fewer than
+/// 2n nodes. A lookup descends from the root comparing one masked word per
+/// node, at most 33 steps whatever the number of prefixes.
+class CidrTree
+{
+public:
+    CidrTree();
+
+    /// network must have its host bits cleared. False if already present.
+    bool insert(uint32_t network, int bits);
+    /// False if not present. Rebuilds the tree.
+    bool erase(uint32_t network, int bits);
+    /// True if a stored prefix contains addr.
+    bool contains(uint32_t addr) const;
+
+    /// Stored prefixes in address order.
+    std::vector<std::pair<uint32_t, int>> prefixes() const;
+    size_t size() const { return _size; }
+    /// Estimated heap bytes.
+    size_t heapBytes() const { return _nodes.capacity() * sizeof(Node); }
+
+private:
+    struct Node
+    {
+        uint32_t prefix;
+        uint8_t bits;
+        bool stored;          // a prefix that was inserted, not only a split
+        uint32_t child[2];    // node indexes; 0 is none (the root is never a child)
+    };
+
+    std::vector<Node> _nodes;  // _nodes[0] is the root, the /0 prefix
+    size_t _size;
+
+    uint32_t addNode(uint32_t prefix, int bits, bool stored);
+    void collect(uint32_t node, std::vector<std::pair<uint32_t, int>>& out) const;
+};
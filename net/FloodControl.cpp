@@ -0,0 +1,77 @@
+#include "FloodControl.hpp"
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "metrics/MemoryUsage.hpp"
+
+FloodClass floodClassFor(const char* line, size_t length)
+{
+    size_t word = 0;
+    while (word < length && line[word] != ' ' && line[word] != '\r') ++word;
+
+    struct Command
+    {
+        const char* name;
+        size_t length;
+        FloodClass group;
+    };
+    static const Command kCommands[] = {
+        {"PRIVMSG", 7, FLOOD_CHAT}, {"NOTICE", 6, FLOOD_CHAT}, {"MSG", 3, FLOOD_CHAT},
+        {"JOIN", 4, FLOOD_JOIN},    {"PART", 4, FLOOD_JOIN},   {"MODE", 4, FLOOD_MODE},
+    };
+    for (const Command& command : kCommands)
+    {
+        if (word == command.length && strncasecmp(line, command.name, word) == 0)
+            return command.group;
+    }
+    return FLOOD_OTHER;
+}
+
+void FloodControl::open(int fd, const ConnectionClass& cls, uint64_t nowNs)
+{
+    Connection& connection = _connections[fd];
+    connection.cls = &cls;
+    for (int group = 0; group < FLOOD_CLASS_COUNT; ++group)
+        connection.buckets[group] = Bucket{cls.flood[group].burst, nowNs};
+}
+
+void FloodControl::close(int fd) { _connections.erase(fd); }
+
+uint64_t FloodControl::take(int fd, FloodClass group, uint64_t nowNs)
+{
+    std::unordered_map<int, Connection>::iterator it = _connections.find(fd);
+    if (it == _connections.end())
+        return 0;
+    const FloodLimit& limit = it->second.cls->flood[group];
+    if (limit.perSecond <= 0)
+        return 0;
+
+    Bucket& bucket = it->second.buckets[group];
+    if (nowNs > bucket.lastNs)
+    {
+        double refill = (nowNs - bucket.lastNs) * limit.perSecond / 1e9;
+        bucket.tokens = std::min(limit.burst, bucket.tokens + refill);
+        bucket.lastNs = nowNs;
+    }
+    if (bucket.tokens >= 1)
+    {
+        bucket.tokens -= 1;
+        return 0;
+    }
+    return nowNs + static_cast<uint64_t>(std::ceil((1 - bucket.tokens) * 1e9 / limit.perSecond));
+}
+
+const ConnectionClass* FloodControl::connectionClass(int fd) const
+{
+    std::unordered_map<int, Connection>::const_iterator it = _connections.find(fd);
+    return it == _connections.end() ? nullptr : it->second.cls;
+}
+
+size_t FloodControl::heapBytes() const
+{
+    return _connections.bucket_count() * sizeof(void*) +
+           _connections.size() * (kHashNodeOverhead + sizeof(*_connections.begin()));
+}
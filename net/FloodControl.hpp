@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "ServerConfig.hpp"
+
+/// Group a raw command line is charged to, from its command word.
+FloodClass floodClassFor(const char* line, size_t length);
+
+/// Per-connection token buckets, one per FloodClass, refilled from the
+/// IoLayer clock so simulated runs throttle the same way every time.
+class FloodControl
+{
+public:
+    void open(int fd, const ConnectionClass& cls, uint64_t nowNs);
+    void close(int fd);
+
+    /// Charges one command of group to fd. Returns 0 when a token was
+    /// taken, otherwise the time at which one will be available; nothing
+    /// is charged then. Fds that were never opened are not limited.
+    uint64_t take(int fd, FloodClass group, uint64_t nowNs);
+
+    /// Class fd was opened with, or nullptr.
+    const ConnectionClass* connectionClass(int fd) const;
+    /// Estimated heap bytes held by the buckets.
+    size_t heapBytes() const;
+
+private:
+    struct Bucket
+    {
+        double tokens;
+        uint64_t lastNs;
+    };
+    struct Connection
+    {
+        const ConnectionClass* cls;
+        Bucket buckets[FLOOD_CLASS_COUNT];
+    };
+
+    std::unordered_map<int, Connection> _connections;
+};
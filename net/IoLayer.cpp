@@ -0,0 +1,95 @@
+#include "IoLayer.hpp"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "metrics/Clock.hpp"
+
+namespace
+{
+
+SystemIo g_systemIo;
+IoLayer* g_io = &g_systemIo;
+
+}  // namespace
+
+IoLayer& io() { return *g_io; }
+
+void setIoLayer(IoLayer* layer) { g_io = layer ? layer : &g_systemIo; }
+
+int SystemIo::listen(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        throw std::runtime_error("Failed to create socket");
+    }
+
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+    {
+        perror("fcntl");
+        ::close(fd);
+        throw std::runtime_error("Failed to set socket to non-blocking");
+    }
+
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    {
+        perror("setsockopt");
+        ::close(fd);
+        throw std::runtime_error("Failed to set socket options");
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        ::close(fd);
+        throw std::runtime_error("Failed to bind");
+    }
+
+    if (::listen(fd, SOMAXCONN) < 0)
+    {
+        perror("listen");
+        ::close(fd);
+        throw std::runtime_error("Failed to listen");
+    }
+    return fd;
+}
+
+int SystemIo::accept(int listenFd, sockaddr_in& peer)
+{
+    socklen_t len = sizeof(peer);
+    int fd = ::accept(listenFd, (sockaddr*)&peer, &len);
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+ssize_t SystemIo::recv(int fd, char* buffer, size_t length)
+{
+    return ::recv(fd, buffer, length, 0);
+}
+
+ssize_t SystemIo::send(int fd, const char* data, size_t length)
+{
+    return ::send(fd, data, length, MSG_NOSIGNAL);
+}
+
+void SystemIo::close(int fd) { ::close(fd); }
+
+int SystemIo::poll(pollfd* fds, size_t count, int timeoutMs)
+{
+    return ::poll(fds, count, timeoutMs);
+}
+
+uint64_t SystemIo::nowNs() { return monotonicNs(); }
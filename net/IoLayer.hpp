@@ -0,0 +1,52 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/types.h>
+
+#include <cstdint>
+
+/// Socket and clock operations used by the server core. Every accept, recv,
+/// send, close and poll on a client socket, and every protocol timestamp,
+/// goes through the active layer. SystemIo forwards to the kernel; SimIo
+/// (net/SimIo.hpp) replaces sockets with in-memory queues and the clock
+/// with a virtual one, so a whole network can be stepped in one process.
+class IoLayer
+{
+public:
+    virtual ~IoLayer() {}
+
+    /// Opens a non-blocking listening socket on port. Throws
+    /// std::runtime_error on failure.
+    virtual int listen(int port) = 0;
+    /// Returns the next pending connection (non-blocking) or -1.
+    virtual int accept(int listenFd, sockaddr_in& peer) = 0;
+    /// recv()/send() semantics: bytes moved, 0 on EOF, -1 with errno set.
+    virtual ssize_t recv(int fd, char* buffer, size_t length) = 0;
+    virtual ssize_t send(int fd, const char* data, size_t length) = 0;
+    virtual void close(int fd) = 0;
+    /// poll() semantics; fds the layer does not own report no events.
+    virtual int poll(pollfd* fds, size_t count, int timeoutMs) = 0;
+    /// Monotonic protocol time in nanoseconds.
+    virtual uint64_t nowNs() = 0;
+};
+
+/// The kernel: sockets, poll() and CLOCK_MONOTONIC.
+class SystemIo : public IoLayer
+{
+public:
+    int listen(int port) override;
+    int accept(int listenFd, sockaddr_in& peer) override;
+    ssize_t recv(int fd, char* buffer, size_t length) override;
+    ssize_t send(int fd, const char* data, size_t length) override;
+    void close(int fd) override;
+    int poll(pollfd* fds, size_t count, int timeoutMs) override;
+    uint64_t nowNs() override;
+};
+
+/// The active layer; SystemIo unless setIoLayer() installed another one.
+IoLayer& io();
+
+/// Installs layer for the whole process (nullptr restores SystemIo). Must be
+/// called before the Server is constructed and outlive it.
+void setIoLayer(IoLayer* layer);
@@ -0,0 +1,144 @@
+#include "IpLimits.hpp"
+
+#include <algorithm>
+
+static const uint64_t kTracked = uint64_t(1) << 32;
+
+IpLimits::IpLimits() : _slots(kMinSlots, Entry{0, 0, 0}), _shift(26), _used(0) {}
+
+IpVerdict IpLimits::admit(int fd, uint32_t key, const ConnectionClass& cls, uint64_t nowNs)
+{
+    const FloodLimit& rate = cls.connectRate;
+    if (cls.maxPerIp == 0 && rate.perSecond <= 0)
+        return IP_ADMITTED;
+
+    size_t slot = find(key);
+    if (slot == _slots.size())
+        slot = insert(key, nowNs);
+    Entry& entry = _slots[slot];
+    if (cls.maxPerIp && entry.connections >= cls.maxPerIp)
+        return IP_TOO_MANY;
+    if (rate.perSecond > 0)
+    {
+        // One connection per intervalNs, up to burst of them back to back.
+        const uint64_t intervalNs = static_cast<uint64_t>(1e9 / rate.perSecond);
+        const uint64_t toleranceNs = static_cast<uint64_t>((rate.burst - 1) * intervalNs);
+        const uint64_t tatNs = std::max(entry.tatNs, nowNs);
+        if (tatNs > nowNs + toleranceNs)
+            return IP_THROTTLED;
+        entry.tatNs = tatNs + intervalNs;
+    }
+    entry.connections++;
+
+    if (static_cast<size_t>(fd) >= _fdKeys.size())
+        _fdKeys.resize(fd + 1, 0);
+    _fdKeys[fd] = kTracked | key;
+    return IP_ADMITTED;
+}
+
+void IpLimits::release(int fd, uint64_t nowNs)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _fdKeys.size() || !_fdKeys[fd])
+        return;
+    uint32_t key = static_cast<uint32_t>(_fdKeys[fd]);
+    _fdKeys[fd] = 0;
+
+    size_t slot = find(key);
+    if (slot == _slots.size())
+        return;
+    _slots[slot].connections--;
+    if (_slots[slot].idle(nowNs))
+        erase(slot);
+}
+
+size_t IpLimits::heapBytes() const
+{
+    return _slots.capacity() * sizeof(Entry) + _fdKeys.capacity() * sizeof(uint64_t);
+}
+
+// Fibonacci hashing: the top bits of key * 2^32/phi.
+size_t IpLimits::home(uint32_t key) const
+{
+    return static_cast<uint32_t>(key * 2654435769u) >> _shift;
+}
+
+size_t IpLimits::find(uint32_t key) const
+{
+    const size_t mask = _slots.size() - 1;
+    for (size_t slot = home(key);; slot = (slot + 1) & mask)
+    {
+        const Entry& entry = _slots[slot];
+        if (entry.empty())
+            return _slots.size();
+        if (entry.key == key)
+            return slot;
+    }
+}
+
+// Adds an entry for key, which must not be present. Keeps the table at most
+// half full, sweeping idle entries before growing it.
+size_t IpLimits::insert(uint32_t key, uint64_t nowNs)
+{
+    if ((_used + 1) * 2 > _slots.size())
+        rebuild(nowNs);
+    const size_t mask = _slots.size() - 1;
+    size_t slot = home(key);
+    while (!_slots[slot].empty()) slot = (slot + 1) & mask;
+    _slots[slot] = Entry{key, 0, 0};
+    ++_used;
+    return slot;
+}
+
+// Backward-shift deletion: entries further along the probe run move into
+// the hole when that brings them no further from their home slot, so no
+// tombstones are needed.
+void IpLimits::erase(size_t slot)
+{
+    const size_t mask = _slots.size() - 1;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; !_slots[next].empty(); next = (next + 1) & mask)
+    {
+        size_t distance = (next - home(_slots[next].key)) & mask;
+        if (((next - hole) & mask) <= distance)
+        {
+            _slots[hole] = _slots[next];
+            hole = next;
+        }
+    }
+    _slots[hole] = Entry{0, 0, 0};
+    --_used;
+}
+
+// Drops idle entries and resizes so that at most a quarter of the slots are
+// used. At least a quarter of the table's slots are inserted between two
+// rebuilds, so the sweep is amortised O(1) per insert.
+void IpLimits::rebuild(uint64_t nowNs)
+{
+    std::vector<Entry> live;
+    live.reserve(_used);
+    for (const Entry& entry : _slots)
+    {
+        if (!entry.empty() && !entry.idle(nowNs))
+            live.push_back(entry);
+    }
+
+    size_t slots = kMinSlots;
+    unsigned shift = 26;
+    while ((live.size() + 1) * 4 > slots)
+    {
+        slots *= 2;
+        --shift;
+    }
+    _slots.assign(slots, Entry{0, 0, 0});
+    _slots.shrink_to_fit();
+    _shift = shift;
+    _used = 0;
+    for (const Entry& entry : live)
+    {
+        const size_t mask = _slots.size() - 1;
+        size_t slot = home(entry.key);
+        while (!_slots[slot].empty()) slot = (slot + 1) & mask;
+        _slots[slot] = entry;
+        ++_used;
+    }
+}
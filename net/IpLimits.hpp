@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ServerConfig.hpp"
+
+enum IpVerdict
+{
+    IP_ADMITTED,
+    IP_TOO_MANY,   // the address already has its class's maxPerIp connections
+    IP_THROTTLED,  // connecting faster than the class's connectRate
+};
+
+/// Per-source-address connection counts and connect-rate limits.
+///
+/// Addresses (IPv4, host order, already masked to the configured prefix)
+/// live in an open-addressing table with linear probing. An entry is 16
+/// bytes: the key, the live connection count, and the rate limiter's
+/// state. The limiter uses GCRA, the single-timestamp form of a token
+/// bucket, so no refill has to be computed. An entry is idle once it has no
+/// connections and its bucket is full again. Idle entries are removed when
+/// their last connection closes, or swept out when the table would otherwise
+/// grow. There is no per-tick work.
+class IpLimits
+{
+public:
+    IpLimits();
+
+    /// Decides whether fd, just accepted from key, may stay. Admitted
+    /// connections are counted against key until release(fd). Classes
+    /// without either limit are not tracked at all.
+    IpVerdict admit(int fd, uint32_t key, const ConnectionClass& cls, uint64_t nowNs);
+    void release(int fd, uint64_t nowNs);
+
+    /// Addresses in the table.
+    size_t size() const { return _used; }
+    /// Estimated heap bytes.
+    size_t heapBytes() const;
+
+private:
+    static const size_t kMinSlots = 64;
+
+    struct Entry
+    {
+        uint32_t key;
+        uint32_t connections;
+        uint64_t tatNs;  // GCRA theoretical arrival time; 0 when never charged
+
+        bool empty() const { return connections == 0 && tatNs == 0; }
+        bool idle(uint64_t nowNs) const { return connections == 0 && tatNs <= nowNs; }
+    };
+
+    std::vector<Entry> _slots;  // power-of-two size
+    unsigned _shift;            // 32 - log2(_slots.size())
+    size_t _used;
+    // Per fd: the tracked key plus kTracked, or 0.
+    std::vector<uint64_t> _fdKeys;
+
+    size_t home(uint32_t key) const;
+    size_t find(uint32_t key) const;
+    size_t insert(uint32_t key, uint64_t nowNs);
+    void erase(size_t slot);
+    void rebuild(uint64_t nowNs);
+};
@@ -0,0 +1,159 @@
+#include "SendQueue.hpp"
+
+#include <cerrno>
+
+#include "IoLayer.hpp"
+#include "ServerConfig.hpp"
+#include "metrics/MemoryUsage.hpp"
+
+SendQueues g_sendQueues;
+
+SendQueues::SendQueues()
+    : _queuedBytes(0), _peakQueuedBytes(0), _peakConnectionBytes(0), _droppedBytes(0),
+      _submittedBytes(0)
+{
+}
+
+void SendQueues::open(int fd, const ConnectionClass& cls)
+{
+    close(fd);
+    _queues[fd].cls = &cls;
+}
+
+void SendQueues::close(int fd)
+{
+    std::unordered_map<int, Queue>::iterator it = _queues.find(fd);
+    if (it == _queues.end())
+        return;
+    _queuedBytes -= it->second.size();
+    _queues.erase(it);
+}
+
+void SendQueues::send(int fd, const char* data, size_t length)
+{
+    _submittedBytes += length;
+    std::unordered_map<int, Queue>::iterator it = _queues.find(fd);
+    if (it == _queues.end())
+    {
+        io().send(fd, data, length);
+        return;
+    }
+
+    Queue& queue = it->second;
+    if (queue.overflowed || queue.failed)
+    {
+        _droppedBytes += length;
+        return;
+    }
+    if (queue.size())
+    {
+        enqueue(fd, queue, data, length);
+        return;
+    }
+
+    ssize_t n = io().send(fd, data, length);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            queue.failed = true;
+            return;
+        }
+        n = 0;
+    }
+    if (static_cast<size_t>(n) < length)
+        enqueue(fd, queue, data + n, length - n);
+}
+
+void SendQueues::enqueue(int fd, Queue& queue, const char* data, size_t length)
+{
+    if (queue.size() + length > queue.cls->sendQ)
+    {
+        queue.overflowed = true;
+        _droppedBytes += length;
+        _overflowed.push_back(fd);
+        return;
+    }
+    if (!queue.size())
+        _blocked.push_back(fd);
+    queue.data.append(data, length);
+    _queuedBytes += length;
+    if (_queuedBytes > _peakQueuedBytes)
+        _peakQueuedBytes = _queuedBytes;
+    if (queue.size() > _peakConnectionBytes)
+        _peakConnectionBytes = queue.size();
+}
+
+void SendQueues::consumed(Queue& queue, size_t n)
+{
+    queue.offset += n;
+    _queuedBytes -= n;
+    if (queue.offset == queue.data.size())
+    {
+        queue.data.clear();
+        queue.offset = 0;
+    }
+    else if (queue.offset > queue.data.size() / 2)
+    {
+        // Compact once the written prefix dominates; keeps appends amortised.
+        queue.data.erase(0, queue.offset);
+        queue.offset = 0;
+    }
+}
+
+bool SendQueues::flush(int fd)
+{
+    std::unordered_map<int, Queue>::iterator it = _queues.find(fd);
+    if (it == _queues.end())
+        return true;
+    Queue& queue = it->second;
+    while (queue.size() && !queue.failed)
+    {
+        ssize_t n = io().send(fd, queue.data.data() + queue.offset, queue.size());
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                queue.failed = true;
+                consumed(queue, queue.size());
+            }
+            break;
+        }
+        consumed(queue, n);
+    }
+    return queue.size() == 0;
+}
+
+size_t SendQueues::pending(int fd) const
+{
+    std::unordered_map<int, Queue>::const_iterator it = _queues.find(fd);
+    return it == _queues.end() ? 0 : it->second.size();
+}
+
+const ConnectionClass* SendQueues::connectionClass(int fd) const
+{
+    std::unordered_map<int, Queue>::const_iterator it = _queues.find(fd);
+    return it == _queues.end() ? nullptr : it->second.cls;
+}
+
+std::vector<int> SendQueues::takeBlocked()
+{
+    std::vector<int> blocked;
+    blocked.swap(_blocked);
+    return blocked;
+}
+
+std::vector<int> SendQueues::takeOverflowed()
+{
+    std::vector<int> overflowed;
+    overflowed.swap(_overflowed);
+    return overflowed;
+}
+
+size_t SendQueues::heapBytes() const
+{
+    size_t bytes = _queues.bucket_count() * sizeof(void*);
+    for (const auto& entry : _queues)
+        bytes += kHashNodeOverhead + sizeof(entry) + stringHeapBytes(entry.second.data);
+    return bytes;
+}
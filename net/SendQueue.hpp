@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ConnectionClass;
+
+/// Per-connection output queues (SendQ).
+///
+/// While a connection's queue is empty, output is written straight to the
+/// socket and only the part the socket does not take is queued; once
+/// something is queued, later output goes behind it so ordering holds. The
+/// server flushes queues when poll() reports POLLOUT.
+///
+/// A queue that would grow past its connection class's limit is marked
+/// overflowed: everything sent to it from then on is dropped, and the
+/// server disconnects it with "Max SendQ exceeded" at the end of the tick.
+/// Fds that were never opened (e.g. benchmark fixtures) are written
+/// straight through without a queue.
+class SendQueues
+{
+public:
+    SendQueues();
+
+    void open(int fd, const ConnectionClass& cls);
+    /// Discards fd's queue.
+    void close(int fd);
+
+    void send(int fd, const char* data, size_t length);
+    /// Writes as much of fd's queue as the socket takes. Returns true when
+    /// the queue is empty afterwards.
+    bool flush(int fd);
+
+    size_t pending(int fd) const;
+    /// Class fd was opened with, or nullptr.
+    const ConnectionClass* connectionClass(int fd) const;
+
+    /// Fds whose queue became non-empty since the last call; they need
+    /// POLLOUT.
+    std::vector<int> takeBlocked();
+    /// Fds that exceeded their limit since the last call.
+    std::vector<int> takeOverflowed();
+
+    uint64_t queuedBytes() const { return _queuedBytes; }
+    uint64_t peakQueuedBytes() const { return _peakQueuedBytes; }
+    uint64_t peakConnectionBytes() const { return _peakConnectionBytes; }
+    uint64_t droppedBytes() const { return _droppedBytes; }
+    /// Bytes passed to send(), written, queued or dropped.
+    uint64_t submittedBytes() const { return _submittedBytes; }
+    /// Estimated heap bytes held by the queues.
+    size_t heapBytes() const;
+
+private:
+    struct Queue
+    {
+        std::string data;
+        size_t offset = 0;  // bytes of data already written
+        const ConnectionClass* cls = nullptr;
+        bool overflowed = false;
+        bool failed = false;  // write error; the read side will see it too
+
+        size_t size() const { return data.size() - offset; }
+    };
+
+    std::unordered_map<int, Queue> _queues;
+    std::vector<int> _blocked;
+    std::vector<int> _overflowed;
+    uint64_t _queuedBytes;
+    uint64_t _peakQueuedBytes;
+    uint64_t _peakConnectionBytes;
+    uint64_t _droppedBytes;
+    uint64_t _submittedBytes;
+
+    void enqueue(int fd, Queue& queue, const char* data, size_t length);
+    void consumed(Queue& queue, size_t n);
+};
+
+extern SendQueues g_sendQueues;
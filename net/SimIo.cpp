@@ -0,0 +1,216 @@
+#include "SimIo.hpp"
+
+#include <arpa/inet.h>
+
+#include <cerrno>
+#include <stdexcept>
+
+namespace
+{
+
+// Virtual fds start above stdio so logs read like a real run.
+const int kFirstFd = 3;
+
+// Start the virtual clock away from zero; 0 often means "unset".
+const uint64_t kEpochNs = 1000000000ull;
+
+}  // namespace
+
+SimIo::SimIo()
+    : _listenFd(-1),
+      _nextFd(kFirstFd),
+      _nowNs(kEpochNs),
+      _socketBuffer(0),
+      _sendCalls(0),
+      _recvCalls(0),
+      _pollCalls(0)
+{
+}
+
+SimIo::Socket* SimIo::find(int fd)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _sockets.size() || !_sockets[fd].open)
+        return nullptr;
+    return &_sockets[fd];
+}
+
+size_t SimIo::room(const Socket& s) const
+{
+    if (!_socketBuffer)
+        return static_cast<size_t>(-1);
+    return s.out.size() < _socketBuffer ? _socketBuffer - s.out.size() : 0;
+}
+
+int SimIo::listen(int port)
+{
+    (void)port;
+    if (_listenFd >= 0)
+        throw std::runtime_error("SimIo supports a single listener");
+    _listenFd = _nextFd++;
+    return _listenFd;
+}
+
+int SimIo::connect(uint32_t ipv4)
+{
+    int fd = _nextFd++;
+    if (_sockets.size() <= static_cast<size_t>(fd))
+        _sockets.resize(fd + 1);
+    Socket& s = _sockets[fd];
+    s = Socket();
+    s.peer.sin_family = AF_INET;
+    s.peer.sin_port = htons(static_cast<uint16_t>(40000 + fd % 20000));
+    s.peer.sin_addr.s_addr = htonl(ipv4);
+    _backlog.push_back(fd);
+    return fd;
+}
+
+int SimIo::accept(int listenFd, sockaddr_in& peer)
+{
+    if (listenFd != _listenFd || _backlog.empty())
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    int fd = _backlog.front();
+    _backlog.pop_front();
+    Socket& s = _sockets[fd];
+    s.open = true;
+    peer = s.peer;
+    return fd;
+}
+
+ssize_t SimIo::recv(int fd, char* buffer, size_t length)
+{
+    ++_recvCalls;
+    Socket* s = find(fd);
+    if (!s)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    size_t available = s->in.size() - s->inPos;
+    if (available == 0)
+    {
+        if (s->peerClosed)
+            return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t n = available < length ? available : length;
+    s->in.copy(buffer, n, s->inPos);
+    s->inPos += n;
+    if (s->inPos == s->in.size())
+    {
+        s->in.clear();
+        s->inPos = 0;
+    }
+    return n;
+}
+
+ssize_t SimIo::send(int fd, const char* data, size_t length)
+{
+    ++_sendCalls;
+    Socket* s = find(fd);
+    if (!s || s->peerClosed)
+    {
+        errno = s ? EPIPE : EBADF;
+        return -1;
+    }
+    size_t n = room(*s);
+    if (n == 0)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (n > length)
+        n = length;
+    s->out.append(data, n);
+    if (!s->dirty)
+    {
+        s->dirty = true;
+        _dirty.push_back(fd);
+    }
+    return n;
+}
+
+void SimIo::close(int fd)
+{
+    if (fd == _listenFd)
+    {
+        _listenFd = -1;
+        return;
+    }
+    Socket* s = find(fd);
+    if (!s)
+        return;
+    s->open = false;
+    s->in.clear();
+    s->inPos = 0;
+}
+
+int SimIo::poll(pollfd* fds, size_t count, int timeoutMs)
+{
+    ++_pollCalls;
+    int ready = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        pollfd& p = fds[i];
+        p.revents = 0;
+        if (p.fd == _listenFd)
+        {
+            if ((p.events & POLLIN) && !_backlog.empty())
+                p.revents |= POLLIN;
+        }
+        else if (Socket* s = find(p.fd))
+        {
+            if ((p.events & POLLIN) && (s->inPos < s->in.size() || s->peerClosed))
+                p.revents |= POLLIN;
+            if ((p.events & POLLOUT) && room(*s))
+                p.revents |= POLLOUT;
+        }
+        if (p.revents)
+            ++ready;
+    }
+    // Nothing to do: "sleep" for the timeout. An infinite timeout returns
+    // at once, since nothing can arrive until the driver acts.
+    if (!ready && timeoutMs > 0)
+        _nowNs += static_cast<uint64_t>(timeoutMs) * 1000000;
+    return ready;
+}
+
+void SimIo::write(int fd, const std::string& data)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _sockets.size())
+        return;
+    _sockets[fd].in += data;
+}
+
+void SimIo::hangup(int fd)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _sockets.size())
+        return;
+    _sockets[fd].peerClosed = true;
+}
+
+size_t SimIo::read(int fd, std::string& out)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _sockets.size())
+        return 0;
+    Socket& s = _sockets[fd];
+    size_t n = s.out.size();
+    out += s.out;
+    s.out.clear();
+    return n;
+}
+
+void SimIo::stall(int fd, bool stalled)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _sockets.size())
+        return;
+    _sockets[fd].stalled = stalled;
+}
+
+bool SimIo::isOpen(int fd) const
+{
+    return fd >= 0 && static_cast<size_t>(fd) < _sockets.size() && _sockets[fd].open;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "IoLayer.hpp"
+
+/// In-memory IoLayer for deterministic simulation. There are no kernel
+/// sockets: each fd is a pair of byte queues, one written by the simulated
+/// peer and read by the server, the other the reverse. Time only moves when
+/// the driver calls advance() or the server polls with a timeout and
+/// nothing is ready. Given the same sequence of driver calls, the server
+/// sees exactly the same bytes in exactly the same order.
+class SimIo : public IoLayer
+{
+public:
+    SimIo();
+
+    int listen(int port) override;
+    int accept(int listenFd, sockaddr_in& peer) override;
+    ssize_t recv(int fd, char* buffer, size_t length) override;
+    ssize_t send(int fd, const char* data, size_t length) override;
+    void close(int fd) override;
+    int poll(pollfd* fds, size_t count, int timeoutMs) override;
+    uint64_t nowNs() override { return _nowNs; }
+
+    // Driver side: the simulated peers.
+
+    /// Queues a connection from ipv4 (host byte order) on the listener and
+    /// returns the fd the server will accept it as.
+    int connect(uint32_t ipv4);
+    /// Appends bytes the peer sends on fd.
+    void write(int fd, const std::string& data);
+    /// Peer half-close: once its queued bytes are read the server sees EOF.
+    void hangup(int fd);
+    /// Moves everything the server sent on fd into out; returns the bytes.
+    size_t read(int fd, std::string& out);
+    /// Calls fn(fd, bytes) for every fd the server wrote to since the last
+    /// call, in the order of their first write, and clears the output.
+    template <typename Fn>
+    void drainOutput(Fn&& fn);
+    /// True while the server has not closed fd.
+    bool isOpen(int fd) const;
+    /// Caps the unread output a socket holds, like a kernel send buffer:
+    /// once full, send() is short or fails with EAGAIN and POLLOUT is not
+    /// reported. 0 (the default) means unlimited.
+    void setSocketBuffer(size_t bytes) { _socketBuffer = bytes; }
+    /// A stalled peer stops reading: drainOutput() leaves its output in the
+    /// socket until it is unstalled.
+    void stall(int fd, bool stalled);
+    void advance(uint64_t ns) { _nowNs += ns; }
+
+    // Counters for the driver's report.
+    uint64_t sendCalls() const { return _sendCalls; }
+    uint64_t recvCalls() const { return _recvCalls; }
+    uint64_t pollCalls() const { return _pollCalls; }
+
+private:
+    struct Socket
+    {
+        std::string in;   // peer -> server
+        size_t inPos = 0;
+        std::string out;  // server -> peer
+        sockaddr_in peer = {};
+        bool open = false;
+        bool peerClosed = false;
+        bool dirty = false;  // listed in _dirty
+        bool stalled = false;
+    };
+
+    int _listenFd;
+    int _nextFd;
+    uint64_t _nowNs;
+    std::vector<Socket> _sockets;  // indexed by fd
+    std::deque<int> _backlog;
+    std::vector<int> _dirty;
+    size_t _socketBuffer;
+    uint64_t _sendCalls;
+    uint64_t _recvCalls;
+    uint64_t _pollCalls;
+
+    Socket* find(int fd);
+    size_t room(const Socket& s) const;
+};
+
+template <typename Fn>
+void SimIo::drainOutput(Fn&& fn)
+{
+    std::vector<int> dirty;
+    dirty.swap(_dirty);
+    for (int fd : dirty)
+    {
+        Socket& s = _sockets[fd];
+        if (s.stalled && s.open)
+        {
+            _dirty.push_back(fd);
+            continue;
+        }
+        s.dirty = false;
+        if (s.out.empty())
+            continue;
+        fn(fd, s.out);
+        s.out.clear();
+    }
+}
@@ -0,0 +1,164 @@
+#include "TimerWheel.hpp"
+
+namespace
+{
+
+const unsigned kLevel0Size = 1u << 8;
+const unsigned kLevelSize = 1u << 6;
+
+// First slot index of each level in _heads.
+int levelBase(int level) { return level == 0 ? 0 : kLevel0Size + (level - 1) * kLevelSize; }
+
+// Bit offset of a level's slot number within a tick.
+unsigned levelShift(int level) { return level == 0 ? 0 : 8 + (level - 1) * 6; }
+
+}  // namespace
+
+TimerWheel::TimerWheel(uint64_t granularityNs, uint64_t nowNs)
+    : _granularityNs(granularityNs), _nextTick(nowNs / granularityNs + 1), _armed(0)
+{
+    for (int& head : _heads) head = -1;
+}
+
+// Rounded up, so a timer's tick never ends before it is due.
+uint64_t TimerWheel::tickOf(uint64_t ns) const
+{
+    return (ns + _granularityNs - 1) / _granularityNs;
+}
+
+void TimerWheel::schedule(int fd, uint64_t dueNs)
+{
+    if (fd < 0)
+        return;
+    if (static_cast<size_t>(fd) >= _nodes.size())
+        _nodes.resize(fd + 1);
+    unlink(fd);
+    _nodes[fd].dueNs = dueNs;
+    file(fd);
+}
+
+void TimerWheel::cancel(int fd)
+{
+    if (fd >= 0 && static_cast<size_t>(fd) < _nodes.size())
+        unlink(fd);
+}
+
+bool TimerWheel::armed(int fd) const
+{
+    return fd >= 0 && static_cast<size_t>(fd) < _nodes.size() && _nodes[fd].slot >= 0;
+}
+
+// Puts an unlinked node into the slot its distance from _nextTick selects.
+void TimerWheel::file(int fd)
+{
+    Node& node = _nodes[fd];
+    uint64_t tick = tickOf(node.dueNs);
+    if (tick < _nextTick)
+        tick = _nextTick;
+    uint64_t distance = tick - _nextTick;
+
+    int level = 0;
+    while (level < kLevels - 1 && distance >= (1ull << levelShift(level + 1))) ++level;
+    if (level == kLevels - 1 && distance >= (1ull << (levelShift(level) + kLevelBits)))
+    {
+        // Beyond the wheel: park in the farthest top-level slot.
+        tick = _nextTick + (1ull << (levelShift(level) + kLevelBits)) - 1;
+    }
+    unsigned width = level == 0 ? kLevel0Size : kLevelSize;
+    node.slot = levelBase(level) + static_cast<int>((tick >> levelShift(level)) & (width - 1));
+
+    node.prev = -1;
+    node.next = _heads[node.slot];
+    if (node.next >= 0)
+        _nodes[node.next].prev = fd;
+    _heads[node.slot] = fd;
+    ++_armed;
+}
+
+void TimerWheel::unlink(int fd)
+{
+    Node& node = _nodes[fd];
+    if (node.slot < 0)
+        return;
+    if (node.prev >= 0)
+        _nodes[node.prev].next = node.next;
+    else
+        _heads[node.slot] = node.next;
+    if (node.next >= 0)
+        _nodes[node.next].prev = node.prev;
+    node.slot = node.prev = node.next = -1;
+    --_armed;
+}
+
+// Re-files the slot of level that starts at _nextTick; its timers now fit
+// in the levels below.
+void TimerWheel::cascade(int level)
+{
+    int slot = levelBase(level) + static_cast<int>((_nextTick >> levelShift(level)) & (kLevelSize - 1));
+    int fd = _heads[slot];
+    _heads[slot] = -1;
+    while (fd >= 0)
+    {
+        int next = _nodes[fd].next;
+        _nodes[fd].slot = -1;
+        --_armed;
+        file(fd);
+        fd = next;
+    }
+}
+
+void TimerWheel::expire(uint64_t nowNs, std::vector<int>& due)
+{
+    const uint64_t lastTick = nowNs / _granularityNs;
+    while (_nextTick <= lastTick)
+    {
+        if (!_armed)
+        {
+            _nextTick = lastTick + 1;
+            break;
+        }
+        unsigned index = _nextTick & (kLevel0Size - 1);
+        if (index == 0)
+        {
+            for (int level = 1; level < kLevels; ++level)
+            {
+                cascade(level);
+                if ((_nextTick >> levelShift(level)) & (kLevelSize - 1))
+                    break;
+            }
+        }
+
+        for (int fd = _heads[index]; fd >= 0;)
+        {
+            int next = _nodes[fd].next;
+            if (_nodes[fd].dueNs > nowNs)
+            {
+                // Parked beyond the wheel's span; file it again.
+                unlink(fd);
+                file(fd);
+            }
+            else
+            {
+                unlink(fd);
+                due.push_back(fd);
+            }
+            fd = next;
+        }
+        ++_nextTick;
+    }
+}
+
+uint64_t TimerWheel::nextWakeNs() const
+{
+    if (!_armed)
+        return UINT64_MAX;
+    // A tick at a level-0 wrap starts with a cascade from above.
+    for (uint64_t tick = _nextTick;; ++tick)
+    {
+        unsigned index = tick & (kLevel0Size - 1);
+        if (index == 0 || _heads[index] >= 0)
+            return tick * _granularityNs;
+    }
+}
+
+size_t TimerWheel::heapBytes() const { return _nodes.capacity() * sizeof(Node); }
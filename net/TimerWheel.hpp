@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Hierarchical timing wheel with at most one timer per fd.
+///
+/// Time is cut into ticks of granularityNs. Level 0 has 256 one-tick slots;
+/// levels 1-3 have 64 slots, each 64 times wider than a slot of the level
+/// below, so the wheel spans 2^26 ticks (about 78 days at 100 ms). A timer
+/// sits in the level its distance selects and moves down one level each
+/// time its slot comes round. Timers further out park in the top level and
+/// are re-filed when they surface. Schedule, cancel and expiry of one timer
+/// are O(1). Advancing the wheel costs one step per tick plus the timers it
+/// touches, whatever the number of armed timers.
+///
+/// A timer never fires before its due time and at most one tick after.
+class TimerWheel
+{
+public:
+    TimerWheel(uint64_t granularityNs, uint64_t nowNs);
+
+    /// Arms (or re-arms) fd's timer for dueNs.
+    void schedule(int fd, uint64_t dueNs);
+    void cancel(int fd);
+    bool armed(int fd) const;
+
+    /// Disarms every timer due at or before nowNs and appends their fds to
+    /// due, earliest tick first.
+    void expire(uint64_t nowNs, std::vector<int>& due);
+
+    /// A time by which expire() should next be called: the end of the
+    /// first non-empty level-0 slot, else the next time level 0 wraps and
+    /// refills from above. UINT64_MAX when no timer is armed.
+    uint64_t nextWakeNs() const;
+
+    size_t size() const { return _armed; }
+    /// Estimated heap bytes.
+    size_t heapBytes() const;
+
+private:
+    static const int kLevels = 4;
+    static const unsigned kLevel0Bits = 8;
+    static const unsigned kLevelBits = 6;
+    static const int kSlots = (1 << kLevel0Bits) + (kLevels - 1) * (1 << kLevelBits);
+
+    struct Node
+    {
+        uint64_t dueNs = 0;
+        int prev = -1;
+        int next = -1;
+        int slot = -1;  // index into _heads; -1 when not armed
+    };
+
+    uint64_t _granularityNs;
+    uint64_t _nextTick;  // every tick before this has been processed
+    std::vector<Node> _nodes;  // indexed by fd
+    int _heads[kSlots];
+    size_t _armed;
+
+    uint64_t tickOf(uint64_t ns) const;
+    void file(int fd);
+    void unlink(int fd);
+    void cascade(int level);
+};
@@ -1,3 +0,0 @@
-#include <regex>
-
-std::regex incorrectRegex("[^a-zA-Z0-9_\\[\\]{}^`|\\-]");
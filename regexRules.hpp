@@ -1,4 +0,0 @@
-#pragma once
-#include <regex>
-
-extern std::regex incorrectRegex;
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// For the main_test_* programs that check results rather than only print
+// them. Each check prints one line; main() returns testResult() so a
+// failure fails run_tests.
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ok    " : "  FAIL  ") << what << std::endl;
+    if (!ok)
+        ++testFailures();
+}
+
+inline void section(const std::string& title) { std::cout << "\n" << title << std::endl; }
+
+inline int testResult() {
+    if (testFailures())
+        std::cout << "\n" << testFailures() << " check(s) failed" << std::endl;
+    else
+        std::cout << "\nall checks passed" << std::endl;
+    return testFailures() ? 1 : 0;
+}
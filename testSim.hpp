@@ -0,0 +1,106 @@
+#pragma once
+
+#include <arpa/inet.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "Server.hpp"
+#include "net/SimIo.hpp"
+
+// A Server on SimIo (see tools/ircsim.cpp) for main_test_* programs that go
+// through the event loop: clients connect from any address, every line runs
+// the real dispatch path, and what the server wrote is read back per fd.
+// One TestNet per program; the server's own logging is discarded.
+class TestNet {
+public:
+    explicit TestNet(const ServerConfig& config = ServerConfig()) {
+        _realCout = std::cout.rdbuf(&_null);
+        setIoLayer(&_sim);
+        _server.reset(new Server(6667, kPassword, false, config));
+        std::cout.rdbuf(_realCout);
+    }
+
+    ~TestNet() {
+        std::cout.rdbuf(&_null);
+        _server.reset();
+        setIoLayer(nullptr);
+        std::cout.rdbuf(_realCout);
+    }
+
+    Server& server() { return *_server; }
+
+    // Ticks until nothing is left to serve.
+    void run() {
+        std::cout.rdbuf(&_null);
+        while (_server->tick(0) > 0) {
+        }
+        std::cout.rdbuf(_realCout);
+    }
+
+    // fn() called directly on the server, with its logging discarded, then
+    // run() so the ticks it scheduled happen.
+    template <typename Fn>
+    bool call(Fn&& fn) {
+        std::cout.rdbuf(&_null);
+        bool result = fn();
+        std::cout.rdbuf(_realCout);
+        run();
+        return result;
+    }
+
+    int connect(const char* address) {
+        in_addr addr;
+        inet_pton(AF_INET, address, &addr);
+        int fd = _sim.connect(ntohl(addr.s_addr));
+        run();
+        output(fd);
+        return fd;
+    }
+
+    // Connects and registers as nick!~user@address; returns the fd with its
+    // welcome already read.
+    int client(const std::string& nick, const char* address,
+               const std::string& user = "") {
+        int fd = connect(address);
+        send(fd, "PASS " + std::string(kPassword));
+        send(fd, "NICK " + nick);
+        send(fd, "USER " + (user.empty() ? nick : user) + " 0 * :" + nick);
+        output(fd);
+        return fd;
+    }
+
+    void send(int fd, const std::string& line) {
+        _sim.write(fd, line + "\r\n");
+        run();
+    }
+
+    // Everything the server wrote to fd since the last call.
+    std::string output(int fd) {
+        std::string out;
+        _sim.read(fd, out);
+        return out;
+    }
+
+    bool isOpen(int fd) const { return _sim.isOpen(fd); }
+
+    static constexpr const char* kPassword = "test";
+
+private:
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    SimIo _sim;
+    NullBuffer _null;
+    std::streambuf* _realCout;
+    std::unique_ptr<Server> _server;
+};
+
+// True if out holds a reply with the given numeric ("474") or command.
+inline bool hasReply(const std::string& out, const std::string& code) {
+    return out.find(" " + code + " ") != std::string::npos;
+}
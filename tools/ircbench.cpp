@@ -0,0 +1,542 @@
+// ircbench: load generator for ircserv.
+//
+// Opens N non-blocking client connections, registers them with
+// PASS/NICK/USER, joins each to a home channel and then drives a weighted
+// mix of PRIVMSG/JOIN/PART/NICK/QUIT at a target rate. Channel messages
+// carry their send timestamp, so every receiving connection records the
+// delivery latency. At the end it reports throughput and p50/p99/p999.
+//
+// Usage: ./ircbench [options]   (see usage() below)
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "metrics/Clock.hpp"
+#include "metrics/Histogram.hpp"
+
+namespace
+{
+
+enum Op
+{
+    OP_PRIVMSG,
+    OP_JOIN,
+    OP_PART,
+    OP_NICK,
+    OP_QUIT,
+    OP_COUNT
+};
+
+const char* const kOpNames[OP_COUNT] = {"privmsg", "join", "part", "nick", "quit"};
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 6667;
+    std::string password = "password";
+    int clients = 100;
+    int channels = 10;
+    double rate = 1000;  // operations per second, all clients together
+    double duration = 10;
+    size_t payload = 64;
+    int connectBatch = 200;  // new connections opened per loop iteration
+    unsigned weights[OP_COUNT] = {90, 3, 3, 2, 2};
+    unsigned seed = 42;
+};
+
+enum State
+{
+    CONNECTING,
+    REGISTERING,
+    READY,
+    CLOSED
+};
+
+struct Conn
+{
+    int fd = -1;
+    State state = CLOSED;
+    int id = 0;
+    int generation = 0;  // bumped on every reconnect, keeps nicks unique
+    int renames = 0;
+    int homeChannel = 0;
+    int extraChannel = -1;
+    std::string in;
+    std::string out;
+};
+
+struct Stats
+{
+    uint64_t connects = 0;
+    uint64_t connectErrors = 0;
+    uint64_t registered = 0;
+    uint64_t disconnects = 0;
+    uint64_t ops[OP_COUNT] = {};
+    uint64_t delivered = 0;
+    uint64_t errorReplies = 0;
+    uint64_t bytesOut = 0;
+    uint64_t bytesIn = 0;
+};
+
+Options g_opt;
+Stats g_stats;
+LatencyHistogram g_latency;
+std::mt19937 g_rng;
+bool g_measuring = false;
+
+void usage()
+{
+    std::cerr << "Usage: ./ircbench [options]\n"
+                 "  -h HOST       server address (127.0.0.1)\n"
+                 "  -p PORT       server port (6667)\n"
+                 "  -w PASS       connection password (password)\n"
+                 "  -c N          concurrent clients (100)\n"
+                 "  -C N          channels; client i joins #bench<i % N> (10)\n"
+                 "  -r RATE       operations per second over all clients (1000)\n"
+                 "  -d SECONDS    measured duration (10)\n"
+                 "  -s BYTES      PRIVMSG payload size (64)\n"
+                 "  -m MIX        weights, e.g. privmsg=90,join=3,part=3,nick=2,quit=2\n"
+                 "  -S SEED       random seed (42)\n";
+    std::exit(2);
+}
+
+void parseMix(const std::string& mix)
+{
+    for (unsigned& w : g_opt.weights) w = 0;
+    size_t start = 0;
+    while (start < mix.size())
+    {
+        size_t comma = mix.find(',', start);
+        std::string item = mix.substr(start, comma == std::string::npos ? comma : comma - start);
+        size_t eq = item.find('=');
+        bool known = false;
+        for (int op = 0; eq != std::string::npos && op < OP_COUNT; ++op)
+        {
+            if (item.compare(0, eq, kOpNames[op]) == 0)
+            {
+                g_opt.weights[op] = static_cast<unsigned>(std::atoi(item.c_str() + eq + 1));
+                known = true;
+            }
+        }
+        if (!known)
+        {
+            std::cerr << "Unknown mix entry: " << item << "\n";
+            usage();
+        }
+        if (comma == std::string::npos)
+            break;
+        start = comma + 1;
+    }
+}
+
+void parseArgs(int argc, char** argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:w:c:C:r:d:s:m:S:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h': g_opt.host = optarg; break;
+            case 'p': g_opt.port = std::atoi(optarg); break;
+            case 'w': g_opt.password = optarg; break;
+            case 'c': g_opt.clients = std::atoi(optarg); break;
+            case 'C': g_opt.channels = std::atoi(optarg); break;
+            case 'r': g_opt.rate = std::atof(optarg); break;
+            case 'd': g_opt.duration = std::atof(optarg); break;
+            case 's': g_opt.payload = static_cast<size_t>(std::atol(optarg)); break;
+            case 'm': parseMix(optarg); break;
+            case 'S': g_opt.seed = static_cast<unsigned>(std::atol(optarg)); break;
+            default: usage();
+        }
+    }
+    if (g_opt.clients <= 0 || g_opt.channels <= 0 || g_opt.rate <= 0 || g_opt.duration <= 0)
+        usage();
+}
+
+void raiseFdLimit()
+{
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+std::string nickFor(const Conn& c)
+{
+    return "b" + std::to_string(c.id) + "g" + std::to_string(c.generation) + "r" +
+           std::to_string(c.renames);
+}
+
+std::string channelName(int index) { return "#bench" + std::to_string(index); }
+
+void queue(Conn& c, const std::string& line)
+{
+    c.out += line;
+    c.out += "\r\n";
+}
+
+bool openConnection(Conn& c, const sockaddr_in& addr)
+{
+    c.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (c.fd < 0)
+    {
+        g_stats.connectErrors++;
+        return false;
+    }
+    fcntl(c.fd, F_SETFL, O_NONBLOCK);
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(c.fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 &&
+        errno != EINPROGRESS)
+    {
+        close(c.fd);
+        c.fd = -1;
+        g_stats.connectErrors++;
+        return false;
+    }
+    c.state = CONNECTING;
+    c.in.clear();
+    c.out.clear();
+    c.extraChannel = -1;
+    g_stats.connects++;
+
+    queue(c, "PASS " + g_opt.password);
+    queue(c, "NICK " + nickFor(c));
+    queue(c, "USER bench" + std::to_string(c.id) + " 0 * :ircbench");
+    return true;
+}
+
+void closeConnection(Conn& c)
+{
+    if (c.fd >= 0)
+        close(c.fd);
+    c.fd = -1;
+    c.state = CLOSED;
+    g_stats.disconnects++;
+}
+
+// Body: "bench <send_ns> <padding>"
+std::string privmsgLine(const Conn& c)
+{
+    std::string body = "bench " + std::to_string(monotonicNs()) + " ";
+    if (body.size() < g_opt.payload)
+        body.append(g_opt.payload - body.size(), 'x');
+    return "PRIVMSG " + channelName(c.homeChannel) + " :" + body;
+}
+
+void handleLine(Conn& c, const std::string& line)
+{
+    if (line.compare(0, 5, "PING ") == 0)
+    {
+        queue(c, "PONG " + line.substr(5));
+        return;
+    }
+
+    size_t bench = line.find(" PRIVMSG #");
+    if (bench != std::string::npos)
+    {
+        size_t body = line.find(":bench ", bench);
+        if (body != std::string::npos)
+        {
+            uint64_t sentNs = std::strtoull(line.c_str() + body + 7, nullptr, 10);
+            uint64_t now = monotonicNs();
+            if (g_measuring && sentNs && now >= sentNs)
+            {
+                g_latency.record(now - sentNs);
+                g_stats.delivered++;
+            }
+        }
+        return;
+    }
+
+    // ":ft_irc NNN nick ..." numerics
+    if (line.size() > 12 && line[0] == ':')
+    {
+        size_t sp = line.find(' ');
+        if (sp != std::string::npos && sp + 4 <= line.size())
+        {
+            std::string code = line.substr(sp + 1, 3);
+            if (code == "001" && c.state == REGISTERING)
+            {
+                c.state = READY;
+                g_stats.registered++;
+                queue(c, "JOIN " + channelName(c.homeChannel));
+            }
+            else if (code[0] == '4' && g_measuring)
+                g_stats.errorReplies++;
+        }
+    }
+}
+
+void readFrom(Conn& c)
+{
+    char buf[16384];
+    while (true)
+    {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0)
+        {
+            g_stats.bytesIn += n;
+            c.in.append(buf, n);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            closeConnection(c);
+            return;
+        }
+        break;
+    }
+
+    size_t start = 0;
+    size_t nl;
+    while ((nl = c.in.find('\n', start)) != std::string::npos)
+    {
+        size_t end = nl;
+        if (end > start && c.in[end - 1] == '\r')
+            --end;
+        handleLine(c, c.in.substr(start, end - start));
+        start = nl + 1;
+    }
+    c.in.erase(0, start);
+}
+
+void writeTo(Conn& c)
+{
+    while (!c.out.empty())
+    {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                closeConnection(c);
+            return;
+        }
+        g_stats.bytesOut += n;
+        c.out.erase(0, n);
+    }
+}
+
+void issueOp(Conn& c, Op op)
+{
+    switch (op)
+    {
+        case OP_PRIVMSG:
+            queue(c, privmsgLine(c));
+            break;
+        case OP_JOIN:
+            c.extraChannel = static_cast<int>(g_rng() % g_opt.channels);
+            queue(c, "JOIN " + channelName(c.extraChannel));
+            break;
+        case OP_PART:
+            if (c.extraChannel < 0 || c.extraChannel == c.homeChannel)
+            {
+                queue(c, privmsgLine(c));
+                op = OP_PRIVMSG;
+                break;
+            }
+            queue(c, "PART " + channelName(c.extraChannel));
+            c.extraChannel = -1;
+            break;
+        case OP_NICK:
+            c.renames++;
+            queue(c, "NICK " + nickFor(c));
+            break;
+        case OP_QUIT:
+            queue(c, "QUIT :ircbench");
+            writeTo(c);
+            if (c.fd >= 0)
+                closeConnection(c);
+            c.generation++;
+            break;
+        default:
+            break;
+    }
+    g_stats.ops[op]++;
+}
+
+void printReport(double elapsed)
+{
+    uint64_t totalOps = 0;
+    for (uint64_t n : g_stats.ops) totalOps += n;
+
+    std::printf("ircbench: %d clients, %d channels, target %.0f ops/s, %.1fs measured\n",
+                g_opt.clients, g_opt.channels, g_opt.rate, elapsed);
+    std::printf("  connects %llu (errors %llu), registered %llu, disconnects %llu\n",
+                (unsigned long long)g_stats.connects, (unsigned long long)g_stats.connectErrors,
+                (unsigned long long)g_stats.registered, (unsigned long long)g_stats.disconnects);
+    std::printf("  ops sent       %llu (%.0f/s):", (unsigned long long)totalOps,
+                totalOps / elapsed);
+    for (int op = 0; op < OP_COUNT; ++op)
+        std::printf(" %s=%llu", kOpNames[op], (unsigned long long)g_stats.ops[op]);
+    std::printf("\n  delivered      %llu messages (%.0f/s)\n",
+                (unsigned long long)g_stats.delivered, g_stats.delivered / elapsed);
+    std::printf("  error replies  %llu\n", (unsigned long long)g_stats.errorReplies);
+    std::printf("  traffic        out %.1f MiB, in %.1f MiB\n", g_stats.bytesOut / 1048576.0,
+                g_stats.bytesIn / 1048576.0);
+    std::printf("  latency (us)   p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+                g_latency.percentile(0.5) / 1e3, g_latency.percentile(0.99) / 1e3,
+                g_latency.percentile(0.999) / 1e3, g_latency.max() / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+    raiseFdLimit();
+    g_rng.seed(g_opt.seed);
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(g_opt.port);
+    if (inet_pton(AF_INET, g_opt.host.c_str(), &addr.sin_addr) != 1)
+    {
+        std::cerr << "Invalid IPv4 address: " << g_opt.host << "\n";
+        return 2;
+    }
+
+    unsigned totalWeight = 0;
+    for (unsigned w : g_opt.weights) totalWeight += w;
+    if (totalWeight == 0)
+    {
+        std::cerr << "Operation mix has no weight\n";
+        return 2;
+    }
+
+    std::vector<Conn> conns(g_opt.clients);
+    for (int i = 0; i < g_opt.clients; ++i)
+    {
+        conns[i].id = i;
+        conns[i].homeChannel = i % g_opt.channels;
+    }
+
+    std::vector<pollfd> pfds;
+    std::vector<int> owner;  // pfds index -> conns index
+
+    int nextToOpen = 0;
+    uint64_t setupDeadline = monotonicNs() + 30ull * 1000000000ull;
+    uint64_t measureStart = 0;
+    uint64_t measureEnd = 0;
+    double credit = 0;
+    uint64_t lastRefill = 0;
+
+    while (true)
+    {
+        uint64_t now = monotonicNs();
+
+        // Ramp up: open a batch of new connections per iteration.
+        for (int opened = 0; nextToOpen < g_opt.clients && opened < g_opt.connectBatch;
+             ++opened, ++nextToOpen)
+            openConnection(conns[nextToOpen], addr);
+
+        if (!g_measuring && nextToOpen == g_opt.clients &&
+            (g_stats.registered >= static_cast<uint64_t>(g_opt.clients) || now > setupDeadline))
+        {
+            std::printf("ircbench: %llu/%d clients registered, measuring for %.1fs\n",
+                        (unsigned long long)g_stats.registered, g_opt.clients, g_opt.duration);
+            g_measuring = true;
+            g_stats = Stats();
+            measureStart = now;
+            measureEnd = now + static_cast<uint64_t>(g_opt.duration * 1e9);
+            lastRefill = now;
+        }
+
+        if (g_measuring)
+        {
+            if (now >= measureEnd)
+                break;
+            credit += (now - lastRefill) * g_opt.rate / 1e9;
+            lastRefill = now;
+            int attempts = 0;
+            while (credit >= 1 && attempts++ < g_opt.clients * 4)
+            {
+                Conn& c = conns[g_rng() % conns.size()];
+                if (c.state == CLOSED)
+                {
+                    openConnection(c, addr);
+                    continue;
+                }
+                if (c.state != READY)
+                    continue;
+                unsigned pick = g_rng() % totalWeight;
+                int op = 0;
+                while (pick >= g_opt.weights[op]) pick -= g_opt.weights[op++];
+                issueOp(c, static_cast<Op>(op));
+                credit -= 1;
+            }
+            if (credit > g_opt.rate)  // never let an idle backlog turn into a burst
+                credit = g_opt.rate;
+        }
+
+        pfds.clear();
+        owner.clear();
+        for (size_t i = 0; i < conns.size(); ++i)
+        {
+            Conn& c = conns[i];
+            if (c.fd < 0)
+                continue;
+            pollfd p = {};
+            p.fd = c.fd;
+            p.events = POLLIN;
+            if (!c.out.empty() || c.state == CONNECTING)
+                p.events |= POLLOUT;
+            pfds.push_back(p);
+            owner.push_back(static_cast<int>(i));
+        }
+
+        int ready = poll(pfds.data(), pfds.size(), 1);
+        if (ready < 0 && errno != EINTR)
+        {
+            perror("poll");
+            return 1;
+        }
+        for (size_t i = 0; ready > 0 && i < pfds.size(); ++i)
+        {
+            if (!pfds[i].revents)
+                continue;
+            Conn& c = conns[owner[i]];
+            if (c.state == CONNECTING)
+            {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err)
+                {
+                    g_stats.connectErrors++;
+                    closeConnection(c);
+                    continue;
+                }
+                c.state = REGISTERING;
+            }
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                readFrom(c);
+            if (c.fd >= 0 && !c.out.empty())
+                writeTo(c);
+        }
+    }
+
+    double elapsed = (monotonicNs() - measureStart) / 1e9;
+    printReport(elapsed);
+    for (Conn& c : conns)
+        if (c.fd >= 0)
+            close(c.fd);
+    return 0;
+}
@@ -0,0 +1,328 @@
+// ircreplay: re-drives a capture_file recording against an ircserv.
+//
+// Every captured connection gets its own socket. Connects, lines and
+// disconnects are issued at their recorded offsets divided by the speed
+// factor (1 = real time, N = N times faster, max = as fast as possible,
+// keeping only the per-connection order). Server output is read and
+// discarded. The report shows how closely the schedule was kept.
+//
+// Usage: ./ircreplay [-h HOST] [-p PORT] [-s SPEED|max] [-w PASSWORD] CAPTURE
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "capture/CaptureFormat.hpp"
+#include "metrics/Clock.hpp"
+#include "metrics/Histogram.hpp"
+
+namespace
+{
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 6667;
+    double speed = 1;  // 0 means as fast as possible
+    std::string password;  // rewrites captured PASS lines when set
+    std::string capture;
+};
+
+struct Conn
+{
+    int fd = -1;
+    bool connected = false;
+    bool closing = false;
+    std::string out;
+};
+
+struct Stats
+{
+    uint64_t connects = 0;
+    uint64_t connectErrors = 0;
+    uint64_t lines = 0;
+    uint64_t disconnects = 0;
+    uint64_t bytesOut = 0;
+    uint64_t bytesIn = 0;
+};
+
+Options g_opt;
+Stats g_stats;
+sockaddr_in g_addr;
+LatencyHistogram g_lag;
+
+void usage()
+{
+    std::cerr << "Usage: ./ircreplay [-h HOST] [-p PORT] [-s SPEED|max] [-w PASSWORD] CAPTURE\n"
+                 "  -s 1      replay in real time (default)\n"
+                 "  -s 10     ten times faster than recorded\n"
+                 "  -s max    no delays; only the order per connection is kept\n"
+                 "  -w PASS   replace the argument of captured PASS lines\n";
+    std::exit(2);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:s:w:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h': g_opt.host = optarg; break;
+            case 'p': g_opt.port = std::atoi(optarg); break;
+            case 's':
+                g_opt.speed = std::string(optarg) == "max" ? 0 : std::atof(optarg);
+                if (std::string(optarg) != "max" && g_opt.speed <= 0)
+                    usage();
+                break;
+            case 'w': g_opt.password = optarg; break;
+            default: usage();
+        }
+    }
+    if (optind != argc - 1)
+        usage();
+    g_opt.capture = argv[optind];
+}
+
+void closeConn(Conn& c)
+{
+    if (c.fd >= 0)
+        close(c.fd);
+    c.fd = -1;
+}
+
+void flush(Conn& c)
+{
+    while (c.connected && !c.out.empty())
+    {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                c.out.clear();
+                closeConn(c);
+            }
+            return;
+        }
+        g_stats.bytesOut += n;
+        c.out.erase(0, n);
+    }
+    if (c.closing && c.out.empty())
+        closeConn(c);
+}
+
+std::string rewrite(const std::string& line)
+{
+    if (g_opt.password.empty() || line.size() < 5 || strncasecmp(line.c_str(), "PASS ", 5) != 0)
+        return line;
+    return "PASS " + g_opt.password;
+}
+
+void replayRecord(std::unordered_map<uint64_t, Conn>& conns, const CaptureRecord& record)
+{
+    switch (record.type)
+    {
+        case CAPTURE_CONNECT:
+        {
+            Conn& c = conns[record.connection];
+            c.fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (c.fd < 0)
+            {
+                g_stats.connectErrors++;
+                return;
+            }
+            fcntl(c.fd, F_SETFL, O_NONBLOCK);
+            int one = 1;
+            setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (connect(c.fd, reinterpret_cast<sockaddr*>(&g_addr), sizeof(g_addr)) < 0 &&
+                errno != EINPROGRESS)
+            {
+                g_stats.connectErrors++;
+                closeConn(c);
+                return;
+            }
+            g_stats.connects++;
+            break;
+        }
+        case CAPTURE_LINE:
+        {
+            std::unordered_map<uint64_t, Conn>::iterator it = conns.find(record.connection);
+            if (it == conns.end() || it->second.fd < 0)
+                return;
+            it->second.out += rewrite(record.line);
+            it->second.out += "\r\n";
+            g_stats.lines++;
+            flush(it->second);
+            break;
+        }
+        case CAPTURE_DISCONNECT:
+        {
+            std::unordered_map<uint64_t, Conn>::iterator it = conns.find(record.connection);
+            if (it == conns.end())
+                return;
+            it->second.closing = true;
+            g_stats.disconnects++;
+            flush(it->second);
+            break;
+        }
+    }
+}
+
+void pollOnce(std::unordered_map<uint64_t, Conn>& conns, int timeoutMs)
+{
+    std::vector<pollfd> pfds;
+    std::vector<Conn*> owners;
+    for (auto& entry : conns)
+    {
+        Conn& c = entry.second;
+        if (c.fd < 0)
+            continue;
+        pollfd p = {};
+        p.fd = c.fd;
+        p.events = POLLIN;
+        if (!c.connected || !c.out.empty())
+            p.events |= POLLOUT;
+        pfds.push_back(p);
+        owners.push_back(&c);
+    }
+    if (poll(pfds.data(), pfds.size(), timeoutMs) <= 0)
+        return;
+
+    char buf[16384];
+    for (size_t i = 0; i < pfds.size(); ++i)
+    {
+        Conn& c = *owners[i];
+        if (!pfds[i].revents || c.fd < 0)
+            continue;
+        if (!c.connected && (pfds[i].revents & (POLLOUT | POLLERR | POLLHUP)))
+        {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err)
+            {
+                g_stats.connectErrors++;
+                closeConn(c);
+                continue;
+            }
+            c.connected = true;
+        }
+        if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            ssize_t n;
+            while ((n = recv(c.fd, buf, sizeof(buf), 0)) > 0) g_stats.bytesIn += n;
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                closeConn(c);
+                continue;
+            }
+        }
+        flush(c);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    g_addr.sin_family = AF_INET;
+    g_addr.sin_port = htons(g_opt.port);
+    if (inet_pton(AF_INET, g_opt.host.c_str(), &g_addr.sin_addr) != 1)
+    {
+        std::cerr << "Invalid IPv4 address: " << g_opt.host << "\n";
+        return 2;
+    }
+
+    try
+    {
+        CaptureReader reader;
+        reader.open(g_opt.capture);
+
+        std::unordered_map<uint64_t, Conn> conns;
+        CaptureRecord record;
+        bool pending = reader.next(record);
+        uint64_t lastRecordNs = 0;
+        const uint64_t start = monotonicNs();
+
+        while (pending)
+        {
+            uint64_t due = g_opt.speed > 0 ? start + static_cast<uint64_t>(record.timeNs / g_opt.speed)
+                                           : 0;
+            uint64_t now = monotonicNs();
+            if (now < due)
+            {
+                pollOnce(conns, static_cast<int>((due - now) / 1000000));
+                continue;
+            }
+            if (due)
+                g_lag.record(now - due);
+            replayRecord(conns, record);
+            lastRecordNs = record.timeNs;
+            pending = reader.next(record);
+
+            // At max speed keep the sockets moving every so often.
+            if (!due && (g_stats.lines & 1023) == 0)
+                pollOnce(conns, 0);
+        }
+
+        // Let the last writes and connects complete.
+        uint64_t drainEnd = monotonicNs() + 2000000000ull;
+        while (monotonicNs() < drainEnd)
+        {
+            bool busy = false;
+            for (auto& entry : conns)
+                busy = busy || (entry.second.fd >= 0 &&
+                                (!entry.second.connected || !entry.second.out.empty()));
+            if (!busy)
+                break;
+            pollOnce(conns, 10);
+        }
+        double elapsed = (monotonicNs() - start) / 1e9;
+        for (auto& entry : conns) closeConn(entry.second);
+
+        std::printf("ircreplay: %s at %s\n", g_opt.capture.c_str(),
+                    g_opt.speed > 0 ? (std::to_string(g_opt.speed) + "x").c_str() : "max speed");
+        std::printf("  capture span   %.3fs, replayed in %.3fs\n", lastRecordNs / 1e9, elapsed);
+        std::printf("  connects %llu (errors %llu), lines %llu (%.0f/s), disconnects %llu\n",
+                    (unsigned long long)g_stats.connects,
+                    (unsigned long long)g_stats.connectErrors, (unsigned long long)g_stats.lines,
+                    g_stats.lines / elapsed, (unsigned long long)g_stats.disconnects);
+        std::printf("  traffic        out %.1f KiB, in %.1f KiB\n", g_stats.bytesOut / 1024.0,
+                    g_stats.bytesIn / 1024.0);
+        if (g_lag.count())
+            std::printf("  schedule lag (us) p50 %.1f  p99 %.1f  max %.1f\n",
+                        g_lag.percentile(0.5) / 1e3, g_lag.percentile(0.99) / 1e3,
+                        g_lag.max() / 1e3);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "[ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,374 @@
+// ircsim: runs the server core against SimIo, with no sockets and no wall
+// clock, and steps a whole network of simulated clients in one process.
+//
+// Phases:
+//   register  every client connects and sends PASS/NICK/USER
+//   join      client i joins #sim<i % CHANNELS>
+//   chat      MESSAGES random PRIVMSGs to the sender's channel; QUIT_PERCENT
+//             of the steps are a QUIT followed by a fresh client taking the
+//             slot; the old peer hangs up after the batch
+//   idle      (-i) IDLE seconds of virtual time in 1 s steps with no input
+//             but PONGs, so the server's keepalive PINGs everyone
+//
+// Every client but a stalled one answers the server's PINGs.
+//
+// With -s, the first STALLED slots never read what the server sends them,
+// and only receive in the chat phase. Their socket buffers fill (-B, 208 KiB
+// if unset), output backs up into the server's send queues and, with a
+// small enough sendq in the config, they are dropped with "Max SendQ
+// exceeded".
+//
+// The driver works in batches: it queues input for BATCH clients, then
+// calls Server::tick(0) until no fd is ready and collects everything the
+// server sent. The virtual clock moves 10 ms per batch. The wall time of
+// each phase is pure server CPU, with no kernel cost. Every byte sent to a
+// client is folded into a digest in delivery order, so two runs with the
+// same options must print the same digest.
+//
+// Usage: ./ircsim [-c CLIENTS] [-C CHANNELS] [-m MESSAGES] [-b BATCH]
+//                 [-q QUIT_PERCENT] [-S SEED] [-f CONFIG]
+//                 [-B SOCKET_BUFFER] [-s STALLED] [-i IDLE]
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Server.hpp"
+#include "ServerConfig.hpp"
+#include "metrics/Clock.hpp"
+#include "net/SendQueue.hpp"
+#include "net/SimIo.hpp"
+
+namespace
+{
+
+struct Options
+{
+    size_t clients = 100000;
+    size_t channels = 1000;
+    size_t messages = 20000;
+    size_t batch = 1000;
+    unsigned quitPercent = 1;
+    unsigned seed = 1;
+    std::string config;
+    size_t socketBuffer = 0;
+    size_t stalled = 0;
+    unsigned idle = 0;
+};
+
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+const char* const kPassword = "sim";
+const uint64_t kBatchNs = 10000000;  // virtual time per batch
+const size_t kDefaultStalledBuffer = 212992;  // Linux default wmem
+const uint64_t kIdleStepNs = 1000000000;  // virtual time per idle step
+
+void usage()
+{
+    std::cerr << "Usage: ./ircsim [-c CLIENTS] [-C CHANNELS] [-m MESSAGES] [-b BATCH]\n"
+                 "                [-q QUIT_PERCENT] [-S SEED] [-f CONFIG]\n"
+                 "                [-B SOCKET_BUFFER] [-s STALLED] [-i IDLE]\n";
+    std::exit(2);
+}
+
+Options parseArgs(int argc, char** argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "c:C:m:b:q:S:f:B:s:i:")) != -1)
+    {
+        switch (c)
+        {
+            case 'c': opt.clients = std::strtoul(optarg, nullptr, 10); break;
+            case 'C': opt.channels = std::strtoul(optarg, nullptr, 10); break;
+            case 'm': opt.messages = std::strtoul(optarg, nullptr, 10); break;
+            case 'b': opt.batch = std::strtoul(optarg, nullptr, 10); break;
+            case 'q': opt.quitPercent = std::strtoul(optarg, nullptr, 10); break;
+            case 'S': opt.seed = std::strtoul(optarg, nullptr, 10); break;
+            case 'f': opt.config = optarg; break;
+            case 'B': opt.socketBuffer = std::strtoul(optarg, nullptr, 10); break;
+            case 's': opt.stalled = std::strtoul(optarg, nullptr, 10); break;
+            case 'i': opt.idle = std::strtoul(optarg, nullptr, 10); break;
+            default: usage();
+        }
+    }
+    if (optind != argc || !opt.clients || !opt.channels || !opt.batch || opt.quitPercent > 100 ||
+        opt.stalled >= opt.clients)
+        usage();
+    if (opt.stalled && !opt.socketBuffer)
+        opt.socketBuffer = kDefaultStalledBuffer;
+    return opt;
+}
+
+struct PhaseStats
+{
+    uint64_t wallNs = 0;
+    uint64_t ticks = 0;
+    uint64_t linesIn = 0;
+    uint64_t linesOut = 0;
+    uint64_t bytesOut = 0;
+    uint64_t sends = 0;
+};
+
+class Simulation
+{
+public:
+    Simulation(const Options& opt, SimIo& sim, Server& server)
+        : _opt(opt), _sim(sim), _server(server), _rng(opt.seed), _digest(14695981039346656037ull),
+          _generation(0), _registered(0)
+    {
+    }
+
+    void registerAll(PhaseStats& stats)
+    {
+        _slots.resize(_opt.clients);
+        for (size_t i = 0; i < _opt.clients; ++i)
+        {
+            _slots[i] = connect(i, stats);
+            if ((i + 1) % _opt.batch == 0)
+                pump(stats);
+        }
+        pump(stats);
+    }
+
+    void joinAll(PhaseStats& stats)
+    {
+        for (size_t i = 0; i < _slots.size(); ++i)
+        {
+            input(_slots[i], "JOIN " + channelOf(i), stats);
+            if ((i + 1) % _opt.batch == 0)
+                pump(stats);
+        }
+        pump(stats);
+    }
+
+    void chat(PhaseStats& stats)
+    {
+        std::uniform_int_distribution<size_t> pick(_opt.stalled, _slots.size() - 1);
+        std::uniform_int_distribution<unsigned> percent(0, 99);
+        for (size_t n = 0; n < _opt.messages; ++n)
+        {
+            size_t i = pick(_rng);
+            if (percent(_rng) < _opt.quitPercent)
+            {
+                input(_slots[i], "QUIT :sim", stats);
+                _hangups.push_back(_slots[i]);
+                _slots[i] = connect(i, stats);
+                input(_slots[i], "JOIN " + channelOf(i), stats);
+            }
+            else
+            {
+                input(_slots[i], "PRIVMSG " + channelOf(i) + " :message " + std::to_string(n),
+                      stats);
+            }
+            if ((n + 1) % _opt.batch == 0)
+                pump(stats);
+        }
+        pump(stats);
+
+        // Let whatever is still queued for live readers go out.
+        for (uint64_t queued = 0; queued != g_sendQueues.queuedBytes();)
+        {
+            queued = g_sendQueues.queuedBytes();
+            pump(stats);
+        }
+    }
+
+    void idle(PhaseStats& stats)
+    {
+        for (unsigned second = 0; second < _opt.idle; ++second)
+        {
+            _sim.advance(kIdleStepNs - kBatchNs);
+            pump(stats);
+        }
+    }
+
+    uint64_t digest() const { return _digest; }
+    size_t stalledDropped() const
+    {
+        size_t dropped = 0;
+        for (size_t i = 0; i < _opt.stalled; ++i)
+            if (!_sim.isOpen(_slots[i]))
+                ++dropped;
+        return dropped;
+    }
+    uint64_t registered() const { return _registered; }
+
+private:
+    const Options& _opt;
+    SimIo& _sim;
+    Server& _server;
+    std::mt19937 _rng;
+    std::vector<int> _slots;  // slot -> current fd
+    std::vector<int> _hangups;  // closed once the server has seen their QUIT
+    std::vector<int> _pongs;    // answer PINGs seen in the last pump
+    uint64_t _digest;
+    uint64_t _generation;
+    uint64_t _registered;
+
+    bool stalled(int fd) const
+    {
+        for (size_t i = 0; i < _opt.stalled; ++i)
+            if (_slots[i] == fd)
+                return true;
+        return false;
+    }
+
+    std::string channelOf(size_t slot) const
+    {
+        return "#sim" + std::to_string(slot % _opt.channels);
+    }
+
+    int connect(size_t slot, PhaseStats& stats)
+    {
+        // 10.0.0.0/8, one address per slot.
+        int fd = _sim.connect((10u << 24) | static_cast<uint32_t>(slot + 1));
+        if (slot < _opt.stalled)
+            _sim.stall(fd, true);
+        std::string nick = "s" + std::to_string(slot) + "g" + std::to_string(_generation++);
+        input(fd, std::string("PASS ") + kPassword, stats);
+        input(fd, "NICK " + nick, stats);
+        input(fd, "USER " + nick + " 0 * :sim", stats);
+        return fd;
+    }
+
+    void input(int fd, const std::string& line, PhaseStats& stats)
+    {
+        _sim.write(fd, line + "\r\n");
+        stats.linesIn++;
+    }
+
+    // Ticks until the server is idle, then collects its output.
+    void pump(PhaseStats& stats)
+    {
+        uint64_t start = monotonicNs();
+        uint64_t sends = _sim.sendCalls();
+        while (_server.tick(0) > 0) stats.ticks++;
+        stats.wallNs += monotonicNs() - start;
+        stats.sends += _sim.sendCalls() - sends;
+
+        _sim.drainOutput([&](int fd, const std::string& bytes) {
+            fold(reinterpret_cast<const char*>(&fd), sizeof(fd));
+            fold(bytes.data(), bytes.size());
+            stats.bytesOut += bytes.size();
+            for (size_t pos = 0; (pos = bytes.find('\n', pos)) != std::string::npos; ++pos)
+                stats.linesOut++;
+            for (size_t pos = 0; (pos = bytes.find(" 001 ", pos)) != std::string::npos; ++pos)
+                _registered++;
+            if (bytes.find("PING :") != std::string::npos && !stalled(fd))
+                _pongs.push_back(fd);
+        });
+        for (int fd : _pongs) input(fd, "PONG :ft_irc", stats);
+        _pongs.clear();
+        for (int fd : _hangups) _sim.hangup(fd);
+        _hangups.clear();
+        _sim.advance(kBatchNs);
+    }
+
+    // FNV-1a, 64 bit.
+    void fold(const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            _digest ^= static_cast<unsigned char>(data[i]);
+            _digest *= 1099511628211ull;
+        }
+    }
+};
+
+void printPhase(const char* name, const PhaseStats& stats)
+{
+    std::printf("  %-9s %9.3fs wall %8llu ticks %10llu lines in %11llu lines out %7.1f MiB",
+                name, stats.wallNs / 1e9, (unsigned long long)stats.ticks,
+                (unsigned long long)stats.linesIn, (unsigned long long)stats.linesOut,
+                stats.bytesOut / 1048576.0);
+    if (stats.linesOut)
+        std::printf("  %.0f ns/line out", static_cast<double>(stats.wallNs) / stats.linesOut);
+    std::printf("  %llu send()\n", (unsigned long long)stats.sends);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt = parseArgs(argc, argv);
+
+    ServerConfig config;
+    config.slowTickMs = 0;  // wall-clock warnings mean nothing here
+    try
+    {
+        if (!opt.config.empty())
+            config.loadFile(opt.config);
+        if (!config.adminSocket.empty() || config.adminPort)
+            throw std::runtime_error("the admin endpoint needs real sockets; disable it");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "[ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+
+    SimIo sim;
+    sim.setSocketBuffer(opt.socketBuffer);
+    setIoLayer(&sim);
+    const uint64_t virtualStart = sim.nowNs();
+
+    // The server logs every line it handles; at this scale that is all the
+    // time there is.
+    NullBuffer null;
+    std::streambuf* realCout = std::cout.rdbuf(&null);
+
+    PhaseStats registerStats, joinStats, chatStats, idleStats;
+    uint64_t digest = 0, registered = 0;
+    size_t stalledDropped = 0;
+    uint64_t pingsSent = 0, pingTimeouts = 0;
+    {
+        Server server(6667, kPassword, false, config);
+        Simulation simulation(opt, sim, server);
+        simulation.registerAll(registerStats);
+        simulation.joinAll(joinStats);
+        simulation.chat(chatStats);
+        simulation.idle(idleStats);
+        digest = simulation.digest();
+        registered = simulation.registered();
+        stalledDropped = simulation.stalledDropped();
+        pingsSent = server.getMetrics().pingsSent;
+        pingTimeouts = server.getMetrics().pingTimeouts;
+    }
+
+    std::cout.rdbuf(realCout);
+    setIoLayer(nullptr);
+
+    std::printf("ircsim: %zu clients, %zu channels, %zu messages, %u%% quits, seed %u\n",
+                opt.clients, opt.channels, opt.messages, opt.quitPercent, opt.seed);
+    printPhase("register", registerStats);
+    printPhase("join", joinStats);
+    printPhase("chat", chatStats);
+    if (opt.idle)
+        printPhase("idle", idleStats);
+    std::printf("  registered %llu, virtual time %.2fs, poll() %llu, recv() %llu\n",
+                (unsigned long long)registered, (sim.nowNs() - virtualStart) / 1e9,
+                (unsigned long long)sim.pollCalls(), (unsigned long long)sim.recvCalls());
+    std::printf("  sendq peak %llu B total, %llu B one connection, %llu B dropped",
+                (unsigned long long)g_sendQueues.peakQueuedBytes(),
+                (unsigned long long)g_sendQueues.peakConnectionBytes(),
+                (unsigned long long)g_sendQueues.droppedBytes());
+    if (opt.stalled)
+        std::printf(", %zu of %zu stalled clients dropped", stalledDropped, opt.stalled);
+    std::printf("\n  keepalive %llu PINGs, %llu timeouts", (unsigned long long)pingsSent,
+                (unsigned long long)pingTimeouts);
+    std::printf("\n  digest %016llx\n", (unsigned long long)digest);
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include "utf8.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTF8_SIMD 1
+#endif
+
+namespace
+{
+
+inline bool isContinuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+// Allowed range for the second byte after lead byte c (Unicode table 3-7),
+// or false when c cannot start a multi-byte sequence.
+bool secondByteRange(unsigned char c, unsigned char& lo, unsigned char& hi, size_t& length)
+{
+    lo = 0x80;
+    hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF)
+        length = 2;
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+        length = 3;
+        if (c == 0xE0)
+            lo = 0xA0;  // overlong
+        else if (c == 0xED)
+            hi = 0x9F;  // surrogates
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+        length = 4;
+        if (c == 0xF0)
+            lo = 0x90;  // overlong
+        else if (c == 0xF4)
+            hi = 0x8F;  // above U+10FFFF
+    }
+    else
+        return false;
+    return true;
+}
+
+// Bytes of the sequence starting at p that form a valid prefix of some
+// well-formed sequence: the whole sequence when it is complete, otherwise
+// its maximal subpart (at least 1).
+size_t sequencePrefix(const unsigned char* p, size_t available, bool& complete)
+{
+    unsigned char lo, hi;
+    size_t length;
+    complete = false;
+    if (!secondByteRange(p[0], lo, hi, length))
+        return 1;
+    if (available < 2 || p[1] < lo || p[1] > hi)
+        return 1;
+    size_t n = 2;
+    while (n < length && n < available && isContinuation(p[n])) ++n;
+    complete = n == length;
+    return n;
+}
+
+// Length of the longest valid prefix of [p, p + length).
+size_t validPrefix(const unsigned char* p, size_t length)
+{
+    size_t i = 0;
+    while (i < length)
+    {
+        uint64_t word;
+        if (i + 8 <= length && (std::memcpy(&word, p + i, 8), !(word & 0x8080808080808080ull)))
+        {
+            i += 8;
+            continue;
+        }
+        if (p[i] < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        bool complete;
+        size_t n = sequencePrefix(p + i, length - i, complete);
+        if (!complete)
+            return i;
+        i += n;
+    }
+    return length;
+}
+
+#ifdef UTF8_SIMD
+
+// Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per
+// Byte" (2021), 16 bytes at a time. Every pair of adjacent bytes is
+// classified by three 16-entry lookups (high and low nibble of the first
+// byte, high nibble of the second); each bit below names one kind of error,
+// and a pair is bad when all three lookups agree on some bit. Third and
+// fourth bytes of a sequence are checked separately against the lead byte
+// two or three positions back.
+#define UTF8_TARGET __attribute__((target("ssse3")))
+
+const uint8_t TOO_SHORT = 1 << 0;  // lead byte, then ASCII or another lead
+const uint8_t TOO_LONG = 1 << 1;   // ASCII, then a continuation
+const uint8_t OVERLONG_3 = 1 << 2;
+const uint8_t TOO_LARGE = 1 << 3;
+const uint8_t SURROGATE = 1 << 4;
+const uint8_t OVERLONG_2 = 1 << 5;
+const uint8_t TOO_LARGE_1000 = 1 << 6;
+const uint8_t OVERLONG_4 = 1 << 6;
+const uint8_t TWO_CONTS = 1 << 7;  // two continuations; fine if 3rd/4th byte
+const uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+UTF8_TARGET inline __m128i highNibbles(__m128i v)
+{
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+}
+
+UTF8_TARGET inline __m128i checkBlock(__m128i input, __m128i previous)
+{
+    const __m128i byte1HighTable =
+        _mm_setr_epi8(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                      TOO_LONG, TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+                      TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+                      TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m128i byte1LowTable = _mm_setr_epi8(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY, CARRY,
+        CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m128i byte2HighTable = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        static_cast<char>(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+                          OVERLONG_4),
+        static_cast<char>(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+        static_cast<char>(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        static_cast<char>(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE), TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(byte1HighTable, highNibbles(prev1)),
+                      _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))),
+        _mm_shuffle_epi8(byte2HighTable, highNibbles(input)));
+
+    // 0x80 where a third or fourth byte must be a continuation; it cancels
+    // the TWO_CONTS bit there, and flags any other byte in that position.
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i isThird = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    __m128i isFourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    __m128i mustContinue =
+        _mm_and_si128(_mm_or_si128(isThird, isFourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(mustContinue, special);
+}
+
+UTF8_TARGET bool isValidUtf8Ssse3(const char* data, size_t length)
+{
+    // Nonzero where the block's last bytes start a sequence it does not
+    // finish.
+    const __m128i incompleteAbove =
+        _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                      static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+                      static_cast<char>(0xC0 - 1));
+    __m128i error = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    __m128i previousIncomplete = _mm_setzero_si128();
+
+    auto step = [&](__m128i input) UTF8_TARGET
+    {
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            // All ASCII: only a sequence left open by the last block can fail.
+            error = _mm_or_si128(error, previousIncomplete);
+            previousIncomplete = _mm_setzero_si128();
+        }
+        else
+        {
+            error = _mm_or_si128(error, checkBlock(input, previous));
+            previousIncomplete = _mm_subs_epu8(input, incompleteAbove);
+        }
+        previous = input;
+    };
+
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64)
+    {
+        const __m128i* block = reinterpret_cast<const __m128i*>(data + i);
+        __m128i in0 = _mm_loadu_si128(block);
+        __m128i in1 = _mm_loadu_si128(block + 1);
+        __m128i in2 = _mm_loadu_si128(block + 2);
+        __m128i in3 = _mm_loadu_si128(block + 3);
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(in0, in1), _mm_or_si128(in2, in3))) == 0)
+        {
+            // 64 ASCII bytes: as step() would do four times.
+            error = _mm_or_si128(error, previousIncomplete);
+            previousIncomplete = _mm_setzero_si128();
+            previous = in3;
+            continue;
+        }
+        step(in0);
+        step(in1);
+        step(in2);
+        step(in3);
+    }
+    for (; i + 16 <= length; i += 16)
+        step(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    if (i < length)
+    {
+        char tail[16] = {};
+        std::memcpy(tail, data + i, length - i);
+        step(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tail)));
+    }
+    error = _mm_or_si128(error, previousIncomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+typedef bool (*Validator)(const char*, size_t);
+
+Validator chooseValidator()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3") ? isValidUtf8Ssse3 : isValidUtf8Scalar;
+}
+
+#endif
+
+}  // namespace
+
+bool isValidUtf8(const char* data, size_t length)
+{
+#ifdef UTF8_SIMD
+    static const Validator validator = chooseValidator();
+    return validator(data, length);
+#else
+    return isValidUtf8Scalar(data, length);
+#endif
+}
+
+bool isValidUtf8Scalar(const char* data, size_t length)
+{
+    return validPrefix(reinterpret_cast<const unsigned char*>(data), length) == length;
+}
+
+std::string repairUtf8(const std::string& text)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t length = text.size();
+    std::string repaired;
+    repaired.reserve(length + 8);
+    size_t i = 0;
+    while (i < length)
+    {
+        size_t valid = validPrefix(p + i, length - i);
+        repaired.append(text, i, valid);
+        i += valid;
+        if (i == length)
+            break;
+        bool complete;
+        i += sequencePrefix(p + i, length - i, complete);
+        repaired += "\xEF\xBF\xBD";
+    }
+    return repaired;
+}
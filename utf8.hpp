@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// True when [data, data + length) is well-formed UTF-8: no overlong forms,
+/// surrogates, code points above U+10FFFF or truncated sequences. Uses the
+/// SSSE3 validator when the CPU has it, the scalar one otherwise.
+bool isValidUtf8(const char* data, size_t length);
+inline bool isValidUtf8(const std::string& text) { return isValidUtf8(text.data(), text.size()); }
+
+/// Byte-at-a-time reference with an 8-byte ASCII fast path.
+bool isValidUtf8Scalar(const char* data, size_t length);
+
+/// text with every maximal invalid subsequence replaced by U+FFFD, as
+/// recommended by Unicode (section 3.9, "U+FFFD Substitution of Maximal
+/// Subparts").
+std::string repairUtf8(const std::string& text);
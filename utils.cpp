@@ -1,13 +1,15 @@
 #include "utils.hpp"
 #include "Server.hpp"
+#include "metrics/ProfScope.hpp"
+#include "net/SendQueue.hpp"
 
-#include <sys/socket.h>  // for send()
 #include <sstream>
 #include <cctype>
 #include <algorithm>
 
 void parser(const std::string& input, std::vector<std::string>& output, char delimiter)
 {
+    PROF_SCOPE("parser");
     std::stringstream ss(input);
     std::string token;
     while (std::getline(ss, token, delimiter))
@@ -17,6 +19,11 @@ void parser(const std::string& input, std::vector<std::string>& output, char del
     }
 }
 
+void sendMessage(int clientFd, const std::string& msg)
+{
+    g_sendQueues.send(clientFd, msg.data(), msg.size());
+}
+
 void sendError(Server& server, int clientFd, const std::string& errorCode, const std::string& nick,
                const std::string& details)
 {
@@ -27,8 +34,7 @@ void sendError(Server& server, int clientFd, const std::string& errorCode, const
 void sendError(int clientFd, const std::string& errorCode, const std::string& nick,
                const std::string& details)
 {
-    std::string msg = ":ft_irc " + errorCode + " " + nick + " " + details + "\r\n";
-    send(clientFd, msg.c_str(), msg.length(), 0);
+    sendMessage(clientFd, ":ft_irc " + errorCode + " " + nick + " " + details + "\r\n");
 }
 
 std::string trimWhitespace(const std::string& str)
@@ -50,6 +56,14 @@ std::string trimWhitespace(const std::string& str)
     return (start > 0) ? result.substr(start) : result;
 }
 
+std::string lastParam(const std::vector<std::string>& params, size_t index)
+{
+    std::string value = params.at(index);
+    if (!value.empty() && value[0] == ':')
+        value.erase(0, 1);
+    return value;
+}
+
 std::string toUpperCase(const std::string& str)
 {
     std::string result = str;
@@ -61,6 +75,7 @@ std::string normalizeChannelName(const std::string& name) { return ircCaseFold(n
 
 std::string ircCaseFold(const std::string& input)
 {
+    PROF_SCOPE("ircCaseFold");
     std::string result = input;
     for (size_t i = 0; i < result.length(); ++i)
     {
@@ -8,6 +8,11 @@ class Server;
 /// Splits a string by a delimiter and fills a vector with the parts.
 void parser(const std::string& input, std::vector<std::string>& output, char delimiter);
 
+/// Sends msg to clientFd, queueing what the socket does not take (see
+/// net/SendQueue.hpp). Every line the server writes to a client goes
+/// through here.
+void sendMessage(int clientFd, const std::string& msg);
+
 /// Sends an IRC error with optional Server object (used if needed for future
 /// logging, etc.)
 void sendError(Server& server, int clientFd, const std::string& errorCode, const std::string& nick,
@@ -21,6 +26,10 @@ void sendError(int clientFd, const std::string& errorCode, const std::string& ni
 /// ends of a string.
 std::string trimWhitespace(const std::string& str);
 
+/// Returns params[index] without the ':' that marks a trailing parameter.
+/// index must be in range.
+std::string lastParam(const std::vector<std::string>& params, size_t index);
+
 std::string toUpperCase(const std::string& str);
 std::string normalizeChannelName(const std::string& name);
 std::string ircCaseFold(const std::string& input);